@@ -0,0 +1,370 @@
+/**************************************************************************/
+/*!
+@file     dump_emu.c
+@brief    Native bulk transfer of lib/transfer on a pseudo terminal
+@license  MIT
+
+Runs the command shell with the dump, ack and nak commands of src/main.c
+on Linux. History and EEPROM log are filled with generated data at start
+and written as history.csv and log.csv, the files tools/dump.py has to
+produce. The UART rings have the sizes of the firmware, the transmit
+ring drains at the baudrate and every received byte is put into the
+receive ring like the receive interrupt does. With a corruption period one byte in that many bytes of
+a running transfer, picked at random, is damaged, so the receiver has to
+ask for blocks again.
+
+Usage: dump_emu [baudrate] [corruption period]
+*/
+/**************************************************************************/
+
+#define _DEFAULT_SOURCE
+#define _XOPEN_SOURCE 600
+#include <fcntl.h>
+#include <math.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <avr/io.h>
+#include <uart.h>
+#include "shell.h"
+#include "transfer.h"
+#include "stats.h"
+#include "history.h"
+#include "logger.h"
+
+#define DUMP_HISTORY 0
+#define DUMP_LOG 1
+
+volatile uint8_t TCCR0A, TCCR0B, TCNT0, OCR0A, TIMSK0, TIFR0;
+volatile uint8_t SREG;
+volatile uint8_t EECR;
+volatile uint16_t EEAR;
+uint8_t emu_eeprom[E2END + 1];
+
+void EE_READY_vect(void);
+
+/// Data register of emulated EEPROM, loaded by a read strobe
+static uint8_t eedr;
+
+uint8_t *emu_eedr(void)
+{
+    if (EECR & (1 << EERE)) {
+        eedr = emu_eeprom[EEAR];
+        EECR &= ~(1 << EERE);
+    }
+    return &eedr;
+}
+
+/// Received bytes, read by the shell through uart_getc(), ring of lib/uart size
+static uint8_t rxBuf[UART_RX_BUFFER_SIZE];
+static uint8_t rxHead, rxTail;
+static unsigned int rxError;
+
+/// Transmit ring like lib/uart, head is the last written byte
+static uint8_t txBuf[UART_TX_BUFFER_SIZE];
+static uint8_t txHead, txTail;
+
+unsigned int uart_getc(void)
+{
+    unsigned int error = rxError;
+
+    if (rxHead == rxTail) return UART_NO_DATA;
+    rxError = 0;
+    rxTail = (rxTail + 1) & (UART_RX_BUFFER_SIZE - 1);
+    return error | rxBuf[rxTail];
+}
+
+static uint8_t tx_free(void)
+{
+    return (txTail - txHead - 1) & (UART_TX_BUFFER_SIZE - 1);
+}
+
+unsigned char uart_tx_reserve(unsigned char offset, unsigned char **span)
+{
+    uint8_t free = tx_free();
+    uint8_t start;
+
+    if (offset >= free) return 0;
+    start = (txHead + 1 + offset) & (UART_TX_BUFFER_SIZE - 1);
+    free -= offset;
+    *span = &txBuf[start];
+    return (free > UART_TX_BUFFER_SIZE - start) ? UART_TX_BUFFER_SIZE - start : free;
+}
+
+void uart_tx_commit(unsigned char count)
+{
+    txHead = (txHead + count) & (UART_TX_BUFFER_SIZE - 1);
+}
+
+unsigned char uart_tx_room(unsigned char size, unsigned char policy)
+{
+    (void)policy;
+    return tx_free() >= size;
+}
+
+static void tx_drain(int fd, unsigned int size);
+static int pty;
+
+void uart_write(const void *data, unsigned int size)
+{
+    const uint8_t *bytes = data;
+
+    while (size--) {
+        if (tx_free() == 0) tx_drain(pty, 1);
+        txHead = (txHead + 1) & (UART_TX_BUFFER_SIZE - 1);
+        txBuf[txHead] = *bytes++;
+    }
+}
+
+/// Corruption period and corrupted bytes
+static unsigned long corruptPeriod, corrupted;
+
+/**************************************************************************/
+/*!
+@brief  Send up to size bytes of the transmit ring to the pty
+*/
+/**************************************************************************/
+
+static void tx_drain(int fd, unsigned int size)
+{
+    uint8_t out[UART_TX_BUFFER_SIZE];
+    unsigned int count = 0;
+
+    while (count < size && txTail != txHead) {
+        txTail = (txTail + 1) & (UART_TX_BUFFER_SIZE - 1);
+        out[count] = txBuf[txTail];
+        if (corruptPeriod && transfer_active() && rand() % corruptPeriod == 0 && out[count] != 0) {
+            out[count] ^= (out[count] == 0x55) ? 0xAA : 0x55;
+            corrupted++;
+        }
+        count++;
+    }
+    if (count && write(fd, out, count) < 0) perror("write");
+}
+
+// -- Commands of src/main.c -----------------------------------------------
+
+static history_iter_t history_iter;
+static uint8_t dump_drops;
+
+static uint8_t dump_history(uint16_t item, uint8_t *data)
+{
+    if (history_iter.index == 0xFFFF || history_iter.index > item) {
+        history_iter_init(&history_iter);
+    }
+    if (history_iter.drops != dump_drops) return 0;
+    while (history_iter.index != item) {
+        if (!history_iter_next(&history_iter)) return 0;
+    }
+    memcpy(data, history_iter.values, sizeof(history_iter.values));
+    return 1;
+}
+
+static uint8_t dump_log(uint16_t item, uint8_t *data)
+{
+    logger_read_slot(item, (logger_record_t *)data);
+    return 1;
+}
+
+static uint8_t cmd_dump(char *args, uint8_t step)
+{
+    uint16_t blocks;
+
+    (void)step;
+    if (strcmp_P(args, PSTR("history")) == 0) {
+        history_iter_init(&history_iter);
+        dump_drops = history_iter.drops;
+        blocks = transfer_start(DUMP_HISTORY, dump_history, history_count(), sizeof(history_iter.values));
+        shell_printf_P(PSTR("dump %u %u %u %u"), DUMP_HISTORY, history_count(),
+                       (unsigned)sizeof(history_iter.values), blocks);
+    } else if (strcmp_P(args, PSTR("log")) == 0) {
+        blocks = transfer_start(DUMP_LOG, dump_log, LOGGER_SLOTS, sizeof(logger_record_t));
+        shell_printf_P(PSTR("dump %u %u %u %u"), DUMP_LOG, (unsigned)LOGGER_SLOTS,
+                       (unsigned)sizeof(logger_record_t), blocks);
+    } else if (strcmp_P(args, PSTR("stop")) == 0) {
+        transfer_stop();
+    } else {
+        shell_printf_P(PSTR("dump history|log|stop"));
+    }
+    return 0;
+}
+
+static uint8_t cmd_ack(char *args, uint8_t step)
+{
+    (void)step;
+    if (!transfer_active()) {
+        shell_printf_P(PSTR("no dump"));
+    } else {
+        transfer_ack(strtoul(args, NULL, 10));
+    }
+    return 0;
+}
+
+static uint8_t cmd_nak(char *args, uint8_t step)
+{
+    (void)step;
+    if (!transfer_active()) {
+        shell_printf_P(PSTR("no dump"));
+    } else {
+        transfer_nak(strtoul(args, NULL, 10));
+    }
+    return 0;
+}
+
+static const shell_command_t commands[] PROGMEM = {
+    {"dump", cmd_dump},
+    {"ack", cmd_ack},
+    {"nak", cmd_nak},
+};
+
+// -- Generated data -------------------------------------------------------
+
+/**************************************************************************/
+/*!
+@brief  Sample of second t: temperature, humidity, CO2 and dust
+*/
+/**************************************************************************/
+
+static void generate(long t, int16_t values[4])
+{
+    values[0] = 215 + 30 * sin(t / 20000.0);
+    values[1] = 450 + 80 * sin(t / 9000.0) + (t % 7);
+    values[2] = 600 + 300 * sin(t / 4000.0) + (t % 13) * 4;
+    values[3] = 120 + (t % 97) + ((t / 600) % 5) * 40;
+}
+
+/**************************************************************************/
+/*!
+@brief  Fill history and EEPROM log through lib/stats like src/main.c, write expected CSV files
+*/
+/**************************************************************************/
+
+static void fill(void)
+{
+    const long hours = 50;
+    int16_t values[STATS_CHANNELS], min[STATS_CHANNELS], max[STATS_CHANNELS];
+    stats_t window;
+    uint8_t done;
+    FILE *file;
+
+    memset(emu_eeprom, 0xFF, sizeof(emu_eeprom));
+    logger_init();
+    for (long t = 0; t < hours * 3600; t++) {
+        generate(t, values);
+        done = stats_add(values);
+        if (done & (1 << STATS_1MIN)) {
+            for (uint8_t i = 0; i < STATS_CHANNELS; i++) {
+                stats_get(STATS_1MIN, i, &window);
+                values[i] = window.mean;
+            }
+            history_add(values);
+        }
+        if (done & (1 << STATS_1H)) {
+            for (uint8_t i = 0; i < STATS_CHANNELS; i++) {
+                stats_get(STATS_1H, i, &window);
+                min[i] = window.min;
+                values[i] = window.mean;
+                max[i] = window.max;
+            }
+            logger_add(min, values, max);
+            // EEPROM ready interrupt until the record is written
+            while (EECR & (1 << EERIE)) {
+                EE_READY_vect();
+                if (EECR & (1 << EEPE)) {
+                    emu_eeprom[EEAR] = eedr;
+                    EECR &= ~((1 << EEPE) | (1 << EEMPE));
+                }
+            }
+        }
+    }
+
+    file = fopen("history.csv", "w");
+    fprintf(file, "index,temperature,humidity,co2,dust\n");
+    history_iter_init(&history_iter);
+    while (history_iter_next(&history_iter)) {
+        fprintf(file, "%u,%d,%d,%d,%d\n", history_iter.index, history_iter.values[0],
+                history_iter.values[1], history_iter.values[2], history_iter.values[3]);
+    }
+    fclose(file);
+
+    file = fopen("log.csv", "w");
+    fprintf(file, "sequence,temperature_min,temperature_mean,temperature_max,humidity_min,"
+            "humidity_mean,humidity_max,co2_min,co2_mean,co2_max,dust_min,dust_mean,dust_max\n");
+    for (uint16_t age = logger_count(); age-- > 0;) {
+        fprintf(file, "%ld", hours - 1 - age);
+        for (uint8_t channel = 0; channel < LOGGER_CHANNELS; channel++) {
+            int16_t aggregate[3];
+            logger_read(age, channel, aggregate);
+            fprintf(file, ",%d,%d,%d", aggregate[0], aggregate[1], aggregate[2]);
+        }
+        fprintf(file, "\n");
+    }
+    fclose(file);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long baud = (argc > 1) ? strtoul(argv[1], NULL, 0) : 500000;
+    struct termios attr;
+    struct pollfd pfd;
+    struct timespec now;
+    double sent = 0;
+    double last;
+
+    corruptPeriod = (argc > 2) ? strtoul(argv[2], NULL, 0) : 0;
+    fill();
+
+    pty = posix_openpt(O_RDWR | O_NOCTTY);
+    if (pty < 0 || grantpt(pty) != 0 || unlockpt(pty) != 0) {
+        perror("pty");
+        return 1;
+    }
+    tcgetattr(pty, &attr);
+    cfmakeraw(&attr);
+    tcsetattr(pty, TCSANOW, &attr);
+    printf("%u history records, %u log records at %lu Bd on %s\n",
+           history_count(), logger_count(), baud, ptsname(pty));
+    fflush(stdout);
+
+    shell_init(NULL, 0, commands, sizeof(commands) / sizeof(commands[0]));
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    last = now.tv_sec + now.tv_nsec * 1e-9;
+
+    while (1) {
+        uint8_t active = transfer_active();
+
+        pfd.fd = pty;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, (txHead != txTail || active) ? 1 : 100) > 0) {
+            uint8_t byte;
+            if (read(pty, &byte, 1) == 1) {
+                // receive interrupt, overflow reported with next byte
+                if (((rxHead + 1) & (UART_RX_BUFFER_SIZE - 1)) == rxTail) {
+                    rxError = UART_BUFFER_OVERFLOW;
+                } else {
+                    rxHead = (rxHead + 1) & (UART_RX_BUFFER_SIZE - 1);
+                    rxBuf[rxHead] = byte;
+                }
+            }
+        }
+        shell_poll();
+        transfer_poll();
+
+        // ring drains at 10 bits per byte
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        sent += (now.tv_sec + now.tv_nsec * 1e-9 - last) * baud / 10;
+        last = now.tv_sec + now.tv_nsec * 1e-9;
+        if (txHead == txTail) sent = 0;
+        if (sent >= 1) {
+            tx_drain(pty, sent);
+            sent -= (unsigned int)sent;
+        }
+        if (active && !transfer_active()) {
+            printf("transfer done, %lu bytes corrupted\n", corrupted);
+            fflush(stdout);
+        }
+    }
+}
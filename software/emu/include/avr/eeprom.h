@@ -0,0 +1,21 @@
+/*
+ * Host replacement of <avr/eeprom.h> for the native emulators.
+ * EEPROM is the array emu_eeprom of dump_emu.c, addresses are offsets.
+ */
+#ifndef EMU_EEPROM_H
+#define EMU_EEPROM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define E2END 0x3FF
+
+extern uint8_t emu_eeprom[E2END + 1];
+
+#define eeprom_busy_wait() do {} while (0)
+#define eeprom_read_byte(addr) (emu_eeprom[(uintptr_t)(addr)])
+#define eeprom_read_word(addr) ((uint16_t)(emu_eeprom[(uintptr_t)(addr)] | emu_eeprom[(uintptr_t)(addr) + 1] << 8))
+#define eeprom_read_block(dst, addr, size) memcpy((dst), &emu_eeprom[(uintptr_t)(addr)], (size))
+
+#endif
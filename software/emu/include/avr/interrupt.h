@@ -0,0 +1,13 @@
+/*
+ * Host replacement of <avr/interrupt.h> for the native emulators.
+ */
+#ifndef EMU_INTERRUPT_H
+#define EMU_INTERRUPT_H
+
+#include <avr/io.h>
+
+#define sei()
+#define cli()
+#define ISR(vector) void vector(void)
+
+#endif
@@ -0,0 +1,27 @@
+/*
+ * Host replacement of <avr/io.h> for the native emulators.
+ * The display bus is emulated by oled_emu.c, Timer0 registers used by
+ * lib/modbus are plain variables of modbus_emu.c, EEPROM registers and
+ * SREG used by lib/logger are emulated by dump_emu.c.
+ */
+#ifndef EMU_IO_H
+#define EMU_IO_H
+
+#include <stdint.h>
+
+#define RAMEND 0x8FF
+
+extern volatile uint8_t TCCR0A, TCCR0B, TCNT0, OCR0A, TIMSK0, TIFR0;
+enum { CS00 = 0, CS01 = 1, CS02 = 2 };
+enum { OCIE0A = 1, OCF0A = 1 };
+
+extern volatile uint8_t SREG;
+enum { SREG_I = 7 };
+
+extern volatile uint8_t EECR;
+extern volatile uint16_t EEAR;
+uint8_t *emu_eedr(void);
+#define EEDR (*emu_eedr())
+enum { EERE = 0, EEPE = 1, EEMPE = 2, EERIE = 3, EEPM0 = 4, EEPM1 = 5 };
+
+#endif
@@ -0,0 +1,22 @@
+/*
+ * Host replacement of <avr/pgmspace.h> for the native emulators.
+ * Program memory is ordinary memory on the host.
+ */
+#ifndef EMU_PGMSPACE_H
+#define EMU_PGMSPACE_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_ptr(addr) (*(void * const *)(addr))
+#define memcpy_P memcpy
+#define strlen_P strlen
+#define strcmp_P strcmp
+#define vsnprintf_P vsnprintf
+
+#endif
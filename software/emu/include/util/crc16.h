@@ -0,0 +1,18 @@
+/*
+ * Host replacement of <util/crc16.h> for the native emulators.
+ */
+#ifndef EMU_CRC16_H
+#define EMU_CRC16_H
+
+#include <stdint.h>
+
+static inline uint16_t _crc16_update(uint16_t crc, uint8_t data)
+{
+    crc ^= data;
+    for (uint8_t i = 0; i < 8; i++) {
+        crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : crc >> 1;
+    }
+    return crc;
+}
+
+#endif
@@ -0,0 +1,10 @@
+/*
+ * Host replacement of <util/delay.h> for the native OLED emulator.
+ */
+#ifndef EMU_DELAY_H
+#define EMU_DELAY_H
+
+#define _delay_ms(ms) ((void)(ms))
+#define _delay_us(us) ((void)(us))
+
+#endif
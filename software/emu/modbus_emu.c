@@ -0,0 +1,130 @@
+/**************************************************************************/
+/*!
+@file     modbus_emu.c
+@brief    Native Modbus RTU slave of lib/modbus on a pseudo terminal
+@license  MIT
+
+Runs lib/modbus on Linux with the register map of src/main.c. The UART is
+a pty, every received byte calls modbus_rx_hook() like the receive
+interrupt does, and silence of the emulated Timer0 compare time calls the
+compare interrupt. A master such as tools/modbus_master.py connects to
+the printed pty. The sample changes once per second.
+
+Usage: modbus_emu [slave address] [baudrate]
+*/
+/**************************************************************************/
+
+#define _DEFAULT_SOURCE
+#define _XOPEN_SOURCE 600
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <avr/io.h>
+#include <uart.h>
+#include "modbus.h"
+#include "telemetry.h"
+
+volatile uint8_t TCCR0A, TCCR0B, TCNT0, OCR0A, TIMSK0, TIFR0;
+
+void TIMER0_COMPA_vect(void);
+
+/// Received bytes, read by modbus_poll() through uart_getc()
+static uint8_t rxBuf[256];
+static uint8_t rxHead, rxTail;
+
+/// Reply bytes, written to the pty after modbus_poll()
+static uint8_t txBuf[256];
+static unsigned int txSize;
+
+unsigned int uart_getc(void)
+{
+    if (rxHead == rxTail) return UART_NO_DATA;
+    return rxBuf[rxTail++];
+}
+
+void uart_putc(unsigned char data)
+{
+    if (txSize < sizeof(txBuf)) txBuf[txSize++] = data;
+}
+
+static telemetry_sample_t sample = {
+    .adcCO2 = 312, .adcDust = 41, .dht12 = {45, 2, 22, 7},
+    .temperature = 227, .humidity = 452, .co2 = 415, .dust = 123,
+    .flags = TELEMETRY_FLAG_VALUES,
+};
+
+static uint16_t dust_period = 9088;
+static uint16_t i2c_khz = 100;
+static uint8_t contrast = 0x3F;
+static uint8_t modbus_address;
+
+static void changed(void)
+{
+    printf("dust_us %u, i2c_khz %u, contrast %u, modbus %u\n",
+           dust_period, i2c_khz, contrast, modbus_address);
+    fflush(stdout);
+}
+
+static const shell_param_t params[] PROGMEM = {
+    {"dust_us",  SHELL_U16, &dust_period,    1000, 16000, changed},
+    {"i2c_khz",  SHELL_U16, &i2c_khz,        32, 400, changed},
+    {"contrast", SHELL_U8,  &contrast,       0, 255, changed},
+    {"modbus",   SHELL_U8,  &modbus_address, 1, 247, changed},
+};
+
+int main(int argc, char *argv[])
+{
+    unsigned long baud = (argc > 2) ? strtoul(argv[2], NULL, 0) : 500000;
+    struct termios attr;
+    struct pollfd pfd;
+    struct timespec now;
+    time_t second = 0;
+    int timeout;
+    int fd;
+
+    modbus_address = (argc > 1) ? atoi(argv[1]) : 1;
+    fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (fd < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0) {
+        perror("pty");
+        return 1;
+    }
+    tcgetattr(fd, &attr);
+    cfmakeraw(&attr);
+    tcsetattr(fd, TCSANOW, &attr);
+    printf("slave %u at %lu Bd on %s\n", modbus_address, baud, ptsname(fd));
+    fflush(stdout);
+
+    modbus_init(&sample, sizeof(sample), params, sizeof(params) / sizeof(params[0]), baud);
+    modbus_enable(modbus_address);
+    // Timer0 compare time in ms, prescaler 256 or 1024 at 16 MHz
+    timeout = (OCR0A * ((TCCR0B & (1 << CS00)) ? 64 : 16) + 999) / 1000;
+
+    while (1) {
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, (TIMSK0 & (1 << OCIE0A)) ? timeout : 100) > 0) {
+            uint8_t byte;
+            if (read(fd, &byte, 1) == 1) {
+                rxBuf[rxHead++] = byte;
+                modbus_rx_hook();
+            }
+        } else if (TIMSK0 & (1 << OCIE0A)) {
+            TIMER0_COMPA_vect();
+        }
+        modbus_poll();
+        if (txSize) {
+            if (write(fd, txBuf, txSize) < 0) perror("write");
+            txSize = 0;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (now.tv_sec != second) {
+            second = now.tv_sec;
+            sample.timestamp += 62500;
+            sample.co2 = 400 + second % 50;
+        }
+    }
+}
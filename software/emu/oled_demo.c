@@ -0,0 +1,141 @@
+/**************************************************************************/
+/*!
+@file     oled_demo.c
+@brief    Native render of the monitor screen through the OLED emulator
+@license  MIT
+
+Draws the screen of src/main.c with fixed values, writes panel snapshots
+as PBM files and prints the bus traffic of each step. Used to check
+layout and to compare I2C traffic when the rendering code changes.
+
+Usage: oled_demo [output directory]
+*/
+/**************************************************************************/
+
+#include <stdio.h>
+#include "oled_emu.h"
+#include <oled.h>
+#include "chart.h"
+#include "widget.h"
+#include <fonts/font_digits24.h>
+#include <fonts/font_digits16.h>
+#include <fonts/font_prop8.h>
+
+static chart_t chart_CO2;
+static chart_t chart_dust;
+static widget_t widget_temp;
+static widget_t widget_hum;
+static widget_t widget_CO2;
+static widget_t widget_dust;
+static widget_t widget_alert;
+
+/**************************************************************************/
+/*!
+@brief  Print and clear bus traffic counters of one step
+
+@param[in] step  Step name
+
+@return None
+*/
+/**************************************************************************/
+
+static void report(const char *step)
+{
+    oled_emu_stats_t stats;
+
+    oled_emu_reset_stats(&stats);
+    printf("%-16s %4u transactions %6u bus bytes %5u command %5u data %7.1f ms\n", step,
+           (unsigned)stats.transactions, (unsigned)stats.bytes,
+           (unsigned)stats.commandBytes, (unsigned)stats.dataBytes,
+           stats.bytes * 9 * 1000.0 / F_SCL);  // 8 bits and ACK per byte
+}
+
+/**************************************************************************/
+/*!
+@brief  Write snapshot of panel
+
+@param[in] dir   Output directory
+@param[in] name  File name
+
+@return None
+*/
+/**************************************************************************/
+
+static void snapshot(const char *dir, const char *name)
+{
+    char path[256];
+
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    if (oled_emu_write_pbm(path) != 0) {
+        fprintf(stderr, "can't write %s\n", path);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const char *dir = (argc > 1) ? argv[1] : ".";
+
+    oled_emu_reset();
+    oled_charMode(NORMALSIZE);
+    chart_init(&chart_CO2, 0, 6, 60, 2);
+    chart_init(&chart_dust, 66, 6, 60, 2);
+    widget_label(0, 1, PSTR("Teplota:"));
+    widget_label(0, 2, PSTR("Vlhkost:"));
+    widget_label(0, 3, PSTR("CO2 ="));
+    widget_label(0, 4, PSTR("Dust ="));
+    widget_init(&widget_temp, 54, 1, PSTR("%4.1f °C"));
+    widget_init(&widget_hum, 54, 2, PSTR("%4.1f %%"));
+    widget_init(&widget_CO2, 36, 3, PSTR("%.1f ppm"));
+    widget_init(&widget_dust, 42, 4, PSTR("%4.2f ug/m3"));
+    widget_init(&widget_alert, 0, 5, PSTR("%s"));
+    oled_init(OLED_DISP_ON);
+    report("boot");
+    snapshot(dir, "boot.pbm");
+
+    for (int i = 0; i < 60; i++) {
+        chart_push(&chart_CO2, 600 + (i * 7) % 90);
+        chart_push(&chart_dust, 20 + (i * 13) % 35);
+    }
+    widget_printf(&widget_temp, 23.4);
+    widget_printf(&widget_hum, 41.0);
+    widget_printf(&widget_CO2, 652.3);
+    widget_printf(&widget_dust, 31.55);
+    widget_printf(&widget_alert, "CO2 ALERT!");
+    oled_display();
+    report("full frame");
+    snapshot(dir, "frame.pbm");
+
+    chart_push(&chart_CO2, 640);
+    chart_push(&chart_dust, 33);
+    oled_display_dirty();
+    report("chart update");
+    snapshot(dir, "chart_update.pbm");
+
+    widget_printf(&widget_temp, 23.4);
+    widget_printf(&widget_hum, 41.0);
+    widget_printf(&widget_CO2, 652.3);
+    widget_printf(&widget_dust, 31.55);
+    widget_printf(&widget_alert, "CO2 ALERT!");
+    oled_display_dirty();
+    report("same values");
+
+    widget_printf(&widget_temp, 23.5);
+    widget_printf(&widget_CO2, 1003.0);
+    widget_printf(&widget_alert, "");
+    oled_display_dirty();
+    report("value update");
+    snapshot(dir, "value_update.pbm");
+
+    oled_clear_buffer();
+    uint8_t x = 100 - oled_font_width(&font_digits24, "652");
+    oled_font_puts(&font_digits24, x, 0, "652");
+    oled_font_puts(&font_prop8, 102, 2, "ppm");
+    oled_font_puts(&font_digits16, 0, 4, "-12.5");
+    oled_font_puts(&font_prop8, 64, 4, "Teplota, Vlhkost");
+    oled_font_puts(&font_prop8, 64, 5, "CO2 ALERT!");
+    oled_display();
+    report("font readout");
+    snapshot(dir, "fonts.pbm");
+
+    return 0;
+}
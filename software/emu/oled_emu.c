@@ -0,0 +1,275 @@
+/**************************************************************************/
+/*!
+@file     oled_emu.c
+@brief    Native (Linux) emulator of the OLED display bus
+@license  MIT
+
+Replaces the TWI library when lib/oled is built on the host. The I2C
+byte stream sent by oled.c is split into commands and display RAM data,
+the commands of the controller selected in oled.h (SH1106 or
+SSD1306/SSD1309) are decoded into a virtual display RAM. The panel image
+can be written as PBM file and the bus bytes are counted.
+
+Page commands 0xB0-0xB7 also set the page pointer in horizontal
+addressing mode of SSD1306, as real controllers do. Segment remap and
+COM scan direction are not emulated, the orientation set by oled_init()
+is assumed.
+*/
+/**************************************************************************/
+
+#include "oled_emu.h"
+#include <oled.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined SH1106
+# define EMU_COLUMNS 132    /*!< Columns of display RAM */
+# define EMU_OFFSET  2      /*!< RAM column of first panel column */
+#else
+# define EMU_COLUMNS 128
+# define EMU_OFFSET  0
+#endif
+
+static oled_emu_state_t emu;
+static oled_emu_stats_t stats;
+
+/*! @brief Position of the next byte in an I2C transaction */
+static enum {
+    BUS_IDLE,       /*!< No start condition or other slave addressed */
+    BUS_ADDRESS,    /*!< Slave address expected */
+    BUS_CONTROL,    /*!< Control byte expected */
+    BUS_STREAM      /*!< Command or data bytes */
+} busState;
+
+static uint8_t streamIsData;    /*!< D/C# bit of last control byte */
+static uint8_t streamSingle;    /*!< Co bit: control byte before every byte */
+
+static uint8_t command;         /*!< Command waiting for arguments */
+static uint8_t args[6];         /*!< Arguments received */
+static uint8_t argsCount;
+static uint8_t argsNeeded;
+
+/**************************************************************************/
+/*!
+@brief  Number of argument bytes following a command byte
+
+@param[in] cmd  Command byte
+
+@return Number of arguments
+*/
+/**************************************************************************/
+
+static uint8_t emu_args_needed(uint8_t cmd)
+{
+    switch (cmd) {
+    case 0x81: case 0xA8: case 0xD3: case 0xD5: case 0xD9: case 0xDA: case 0xDB:
+        return 1;
+#if defined SH1106
+    case 0xAD:
+        return 1;
+#else
+    case 0x20: case 0x8D:
+        return 1;
+    case 0x21: case 0x22: case 0xA3:
+        return 2;
+    case 0x29: case 0x2A:
+        return 5;
+    case 0x26: case 0x27:
+        return 6;
+#endif
+    default:
+        return 0;
+    }
+}
+
+/**************************************************************************/
+/*!
+@brief  Execute complete command with its arguments
+
+@param[in] cmd  Command byte
+
+@return None
+*/
+/**************************************************************************/
+
+static void emu_command(uint8_t cmd)
+{
+    if (cmd <= 0x0F) {
+        emu.column = (emu.column & 0xF0) | cmd;
+    } else if (cmd <= 0x1F) {
+        emu.column = (emu.column & 0x0F) | ((cmd & 0x0F) << 4);
+    } else if (cmd >= 0x40 && cmd <= 0x7F) {
+        emu.startLine = cmd & 0x3F;
+    } else if (cmd >= 0xB0 && cmd <= 0xB7) {
+        emu.page = cmd & 0x07;
+    } else {
+        switch (cmd) {
+        case 0x81: emu.contrast = args[0]; break;
+        case 0xA6: emu.inverted = 0; break;
+        case 0xA7: emu.inverted = 1; break;
+        case 0xAE: emu.displayOn = 0; break;
+        case 0xAF: emu.displayOn = 1; break;
+#if !defined SH1106
+        case 0x20: emu.addressingMode = args[0] & 0x03; break;
+        case 0x21:
+            emu.columnStart = args[0] & 0x7F;
+            emu.columnEnd = args[1] & 0x7F;
+            emu.column = emu.columnStart;
+            break;
+        case 0x22:
+            emu.pageStart = args[0] & 0x07;
+            emu.pageEnd = args[1] & 0x07;
+            emu.page = emu.pageStart;
+            break;
+        case 0x2E: emu.scrolling = 0; break;
+        case 0x2F: emu.scrolling = 1; break;
+#endif
+        default: break; /* no effect on display RAM */
+        }
+    }
+}
+
+/**************************************************************************/
+/*!
+@brief  Write one byte to display RAM and advance the address pointers
+
+@param[in] byte  Data byte
+
+@return None
+*/
+/**************************************************************************/
+
+static void emu_data(uint8_t byte)
+{
+    if (emu.column < EMU_COLUMNS) {
+        emu.ram[emu.page][emu.column] = byte;
+    }
+#if defined SH1106
+    /* Page addressing only, column pointer stops at last column */
+    if (emu.column < EMU_COLUMNS - 1) emu.column++;
+#else
+    if (emu.addressingMode == 1) {
+        if (++emu.page > emu.pageEnd) {
+            emu.page = emu.pageStart;
+            if (++emu.column > emu.columnEnd) emu.column = emu.columnStart;
+        }
+    } else if (emu.addressingMode == 0) {
+        if (++emu.column > emu.columnEnd) {
+            emu.column = emu.columnStart;
+            if (++emu.page > emu.pageEnd) emu.page = emu.pageStart;
+        }
+    } else {
+        if (++emu.column > emu.columnEnd) emu.column = emu.columnStart;
+    }
+#endif
+}
+
+void oled_emu_reset(void)
+{
+    memset(&emu, 0, sizeof(emu));
+    emu.addressingMode = 2;
+    emu.columnEnd = 127;
+    emu.pageEnd = 7;
+    emu.contrast = 0x7F;
+    busState = BUS_IDLE;
+    argsNeeded = 0;
+    memset(&stats, 0, sizeof(stats));
+}
+
+void oled_emu_byte(uint8_t byte, uint8_t isData)
+{
+    if (isData) {
+        stats.dataBytes++;
+        emu_data(byte);
+        return;
+    }
+
+    stats.commandBytes++;
+    if (argsNeeded) {
+        args[argsCount++] = byte;
+        if (--argsNeeded == 0) emu_command(command);
+        return;
+    }
+    command = byte;
+    argsCount = 0;
+    argsNeeded = emu_args_needed(byte);
+    if (argsNeeded == 0) emu_command(command);
+}
+
+const oled_emu_state_t *oled_emu_state(void)
+{
+    return &emu;
+}
+
+uint8_t oled_emu_pixel(uint8_t x, uint8_t y)
+{
+    uint8_t row = (y + emu.startLine) & (DISPLAY_HEIGHT - 1);
+    uint8_t on = (emu.ram[row / 8][x + EMU_OFFSET] >> (row % 8)) & 1;
+
+    if (!emu.displayOn) return 0;
+    return emu.inverted ? !on : on;
+}
+
+int oled_emu_write_pbm(const char *path)
+{
+    FILE *f = fopen(path, "w");
+
+    if (f == NULL) return -1;
+    fprintf(f, "P1\n%d %d\n", DISPLAY_WIDTH, DISPLAY_HEIGHT);
+    for (uint8_t y = 0; y < DISPLAY_HEIGHT; y++) {
+        for (uint8_t x = 0; x < DISPLAY_WIDTH; x++) {
+            fputc(oled_emu_pixel(x, y) ? '1' : '0', f);
+        }
+        fputc('\n', f);
+    }
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+void oled_emu_reset_stats(oled_emu_stats_t *copy)
+{
+    if (copy) *copy = stats;
+    memset(&stats, 0, sizeof(stats));
+}
+
+/* -- TWI shim, see twi.h ---------------------------------------------- */
+
+void twi_init(void)
+{
+}
+
+void twi_start(void)
+{
+    stats.transactions++;
+    busState = BUS_ADDRESS;
+}
+
+uint8_t twi_write(uint8_t data)
+{
+    stats.bytes++;
+    switch (busState) {
+    case BUS_ADDRESS:
+        if (data != ((OLED_I2C_ADR << 1) | TWI_WRITE)) {
+            busState = BUS_IDLE;
+            return 1;   /* NACK, no such slave */
+        }
+        busState = BUS_CONTROL;
+        break;
+    case BUS_CONTROL:
+        streamSingle = (data & 0x80) != 0;
+        streamIsData = (data & 0x40) != 0;
+        busState = BUS_STREAM;
+        break;
+    case BUS_STREAM:
+        oled_emu_byte(data, streamIsData);
+        if (streamSingle) busState = BUS_CONTROL;
+        break;
+    default:
+        return 1;
+    }
+    return 0;
+}
+
+void twi_stop(void)
+{
+    busState = BUS_IDLE;
+}
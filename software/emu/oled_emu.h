@@ -0,0 +1,135 @@
+/**************************************************************************/
+/*!
+@file     oled_emu.h
+@brief    Header for native (Linux) emulator of the OLED display bus
+*/
+/**************************************************************************/
+
+#ifndef OLED_EMU_H
+#define OLED_EMU_H
+
+#include <stdint.h>
+
+/// Columns of controller display RAM (SH1106 has 132, SSD1306 128)
+#define EMU_RAM_WIDTH 132
+/// Pages of controller display RAM
+#define EMU_RAM_PAGES 8
+
+/**************************************************************************/
+/*!
+@brief  Bus traffic counters
+
+Counted since the last oled_emu_reset_stats(), bytes include the I2C
+address and control bytes of each transaction.
+*/
+/**************************************************************************/
+
+typedef struct {
+    uint32_t transactions;  /*!< I2C start conditions */
+    uint32_t bytes;         /*!< All bytes on the bus */
+    uint32_t commandBytes;  /*!< Command bytes decoded */
+    uint32_t dataBytes;     /*!< Bytes written to display RAM */
+} oled_emu_stats_t;
+
+/**************************************************************************/
+/*!
+@brief  Controller state and display RAM decoded from the bus
+*/
+/**************************************************************************/
+
+typedef struct {
+    uint8_t ram[EMU_RAM_PAGES][EMU_RAM_WIDTH]; /*!< Display RAM (GDDRAM) */
+    uint8_t page;           /*!< Page pointer */
+    uint8_t column;         /*!< Column pointer */
+    uint8_t addressingMode; /*!< SSD1306: 0 horizontal, 1 vertical, 2 page */
+    uint8_t columnStart;    /*!< SSD1306 column range of horizontal mode */
+    uint8_t columnEnd;
+    uint8_t pageStart;      /*!< SSD1306 page range of horizontal mode */
+    uint8_t pageEnd;
+    uint8_t startLine;      /*!< RAM row shown at top of display */
+    uint8_t contrast;
+    uint8_t inverted;       /*!< 0xA7 received */
+    uint8_t displayOn;      /*!< 0xAF received */
+    uint8_t scrolling;      /*!< SSD1306 continuous scroll active */
+} oled_emu_state_t;
+
+/**************************************************************************/
+/*!
+@brief  Reset emulated controller to its power-on state and clear counters
+
+@return None
+*/
+/**************************************************************************/
+
+void oled_emu_reset(void);
+
+/**************************************************************************/
+/*!
+@brief  Feed one byte of the command or data stream to the decoder
+
+Used by the TWI shim, other bus shims (e.g. SPI with DC pin) call it
+directly.
+
+@param[in] byte    Byte sent to the display
+@param[in] isData  1 for display RAM data, 0 for command
+
+@return None
+*/
+/**************************************************************************/
+
+void oled_emu_byte(uint8_t byte, uint8_t isData);
+
+/**************************************************************************/
+/*!
+@brief  Read emulated controller state
+
+@return Pointer to the decoded state
+*/
+/**************************************************************************/
+
+const oled_emu_state_t *oled_emu_state(void);
+
+/**************************************************************************/
+/*!
+@brief  Read one pixel as shown on the panel
+
+Applies the display start line, the column offset of the controller and
+inversion, display off shows all pixels dark.
+
+@param[in] x  Column of panel (0–127)
+@param[in] y  Row of panel (0–63)
+
+@return 1 if pixel is lit
+*/
+/**************************************************************************/
+
+uint8_t oled_emu_pixel(uint8_t x, uint8_t y);
+
+/**************************************************************************/
+/*!
+@brief  Write panel image as plain PBM (P1) file
+
+Plain PBM is text, snapshots can be compared by diff for pixel-exact
+regression checks.
+
+@param[in] path  File name
+
+@return 0 on success, -1 if file can't be written
+*/
+/**************************************************************************/
+
+int oled_emu_write_pbm(const char *path);
+
+/**************************************************************************/
+/*!
+@brief  Read and clear bus traffic counters
+
+@param[out] stats  Counters since the last call (may be NULL)
+
+@return None
+*/
+/**************************************************************************/
+
+void oled_emu_reset_stats(oled_emu_stats_t *stats);
+
+#endif
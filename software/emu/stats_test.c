@@ -0,0 +1,104 @@
+/**************************************************************************/
+/*!
+@file     stats_test.c
+@brief    Native test of lib/stats against a double precision reference
+@license  MIT
+
+Feeds lib/stats with generated samples of four channels for some hours
+and checks every completed window of every level against mean, standard
+deviation, minimum and maximum computed in double from the kept samples.
+Means and deviations may be off by one unit at most, minima and maxima
+have to be exact.
+
+Usage: stats_test, exit status 0 if all windows pass
+*/
+/**************************************************************************/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "stats.h"
+
+/// Samples of the longest window
+#define LONGEST (STATS_WINDOW0 * STATS_WINDOW1 * STATS_WINDOW2)
+
+/// Allowed error of means and deviations, in units of the samples
+#define TOLERANCE 1.0
+
+static int16_t kept[STATS_CHANNELS][LONGEST]; /*!< Ring of last samples */
+
+/**************************************************************************/
+/*!
+@brief  Sample of second t: slow waves, noise, spikes and full range
+*/
+/**************************************************************************/
+
+static void generate(long t, int16_t values[STATS_CHANNELS])
+{
+    values[0] = 215 + 30 * sin(t / 2000.0) + rand() % 5;
+    values[1] = 450 + rand() % 100;
+    values[2] = 400 + rand() % 200 + ((t % 97 == 0) ? 5000 : 0);
+    values[3] = rand() % 65536 - 32768;
+}
+
+int main(void)
+{
+    const long seconds = 5L * LONGEST + 17;
+    const long windows[STATS_LEVELS] = {STATS_WINDOW0, STATS_WINDOW0 * STATS_WINDOW1, LONGEST};
+    double worst[STATS_LEVELS][2] = {{0}};
+    long checked = 0;
+    int failed = 0;
+
+    srand(1);
+    for (long t = 0; t < seconds; t++) {
+        int16_t values[STATS_CHANNELS];
+        uint8_t done;
+
+        generate(t, values);
+        for (uint8_t i = 0; i < STATS_CHANNELS; i++) kept[i][t % LONGEST] = values[i];
+        done = stats_add(values);
+
+        for (uint8_t level = 0; level < STATS_LEVELS; level++) {
+            if (!(done & (1 << level))) continue;
+            for (uint8_t i = 0; i < STATS_CHANNELS; i++) {
+                double mean = 0, var = 0;
+                int16_t min = INT16_MAX, max = INT16_MIN;
+                stats_t result;
+
+                for (long s = t + 1 - windows[level]; s <= t; s++) {
+                    int16_t v = kept[i][s % LONGEST];
+                    mean += v;
+                    if (v < min) min = v;
+                    if (v > max) max = v;
+                }
+                mean /= windows[level];
+                for (long s = t + 1 - windows[level]; s <= t; s++) {
+                    double d = kept[i][s % LONGEST] - mean;
+                    var += d * d;
+                }
+                var /= windows[level];
+
+                if (stats_get(level, i, &result) != windows[level] / (level ? windows[level - 1] : 1)) {
+                    printf("level %u channel %u at %ld: wrong item count\n", level, i, t);
+                    failed = 1;
+                }
+                double errMean = fabs(result.mean - mean);
+                double errStd = fabs(result.std - sqrt(var));
+                if (errMean > worst[level][0]) worst[level][0] = errMean;
+                if (errStd > worst[level][1]) worst[level][1] = errStd;
+                if (errMean > TOLERANCE || errStd > TOLERANCE || result.min != min || result.max != max) {
+                    printf("level %u channel %u at %ld: mean %d (%.2f), std %u (%.2f), min %d (%d), max %d (%d)\n",
+                           level, i, t, result.mean, mean, result.std, sqrt(var), result.min, min, result.max, max);
+                    failed = 1;
+                }
+                checked++;
+            }
+        }
+    }
+
+    for (uint8_t level = 0; level < STATS_LEVELS; level++) {
+        printf("level %u: worst error of mean %.2f, of std %.2f\n", level, worst[level][0], worst[level][1]);
+    }
+    printf("%ld windows checked, %s\n", checked, failed ? "FAILED" : "passed");
+    return failed;
+}
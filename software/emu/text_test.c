@@ -0,0 +1,76 @@
+/**************************************************************************/
+/*!
+@file     text_test.c
+@brief    Native check of the TEXTMODE glyph path of lib/oled
+@license  MIT
+
+Builds lib/oled in TEXTMODE against the bus emulator. Moves the display
+start line by oled_scroll_line() and prints NORMALSIZE and DOUBLESIZE
+text. Address commands of a glyph must not touch the start line, and a
+double size glyph has to reach both pages at its column.
+
+Usage: text_test, exit status 0 if all checks pass
+*/
+/**************************************************************************/
+
+#include <stdio.h>
+#include "oled_emu.h"
+#include <oled.h>
+
+/**************************************************************************/
+/*!
+@brief  Check that page holds lit pixels in columns x to x+width-1 of panel
+
+Columns of the panel are shifted by 2 in display RAM of SH1106.
+*/
+/**************************************************************************/
+
+static int page_lit(uint8_t page, uint8_t x, uint8_t width)
+{
+    const oled_emu_state_t *state = oled_emu_state();
+    uint8_t offset = (EMU_RAM_WIDTH - DISPLAY_WIDTH) / 2;
+
+    for (uint8_t i = 0; i < width; i++) {
+        if (state->ram[page][offset + x + i] != 0) return 1;
+    }
+    return 0;
+}
+
+int main(void)
+{
+    const oled_emu_state_t *state = oled_emu_state();
+    uint8_t startLine;
+    int failed = 0;
+
+    oled_emu_reset();
+    oled_init(OLED_DISP_ON);
+    for (uint8_t i = 0; i < 3; i++) oled_scroll_line();
+    startLine = state->startLine;
+
+    oled_charMode(NORMALSIZE);
+    oled_gotoxy(0, 1);
+    oled_puts("12");
+    if (state->startLine != startLine) {
+        printf("NORMALSIZE text moved start line from %u to %u\n", startLine, state->startLine);
+        failed = 1;
+    }
+
+    oled_charMode(DOUBLESIZE);
+    oled_gotoxy(0, 3);
+    oled_puts("42");
+    if (state->startLine != startLine) {
+        printf("DOUBLESIZE text moved start line from %u to %u\n", startLine, state->startLine);
+        failed = 1;
+    }
+    if (!page_lit(3, 0, 24) || !page_lit(4, 0, 24)) {
+        printf("DOUBLESIZE glyphs missing in pages 3 and 4\n");
+        failed = 1;
+    }
+    if (page_lit(3, 24, DISPLAY_WIDTH - 24) || page_lit(4, 24, DISPLAY_WIDTH - 24)) {
+        printf("DOUBLESIZE glyphs written beyond their columns\n");
+        failed = 1;
+    }
+
+    printf("start line %u, %s\n", startLine, failed ? "FAILED" : "passed");
+    return failed;
+}
@@ -0,0 +1,146 @@
+/**************************************************************************/
+/*!
+@file     chart.c
+@brief    Incremental trend chart on the OLED display buffer
+@license  MIT
+
+Keeps a fixed ring of samples and draws them as a sparkline. A new sample
+shifts the chart one column left and draws only the new column, the scale
+is computed in integer math.
+*/
+/**************************************************************************/
+
+#include "chart.h"
+#include <oled.h>
+
+#if !defined GRAPHICMODE
+# error "Chart needs the display buffer, set GRAPHICMODE in oled.h"
+#endif
+
+/**************************************************************************/
+/*!
+@brief  Convert sample to display row of chart
+
+@param[in] chart  Chart state
+@param[in] value  Sample
+
+@return Display row (pixel) of sample
+*/
+/**************************************************************************/
+
+static uint8_t chart_row(const chart_t *chart, int16_t value)
+{
+    uint8_t top = chart->line * 8;
+    uint8_t height = chart->lines * 8 - 1;
+    int32_t range = (int32_t)chart->max - chart->min;
+
+    if (range <= 0) return top + height;
+    return top + height - (uint8_t)((((int32_t)value - chart->min) * height) / range);
+}
+
+/**************************************************************************/
+/*!
+@brief  Draw one column of chart connecting previous and actual sample
+
+@param[in] chart     Chart state
+@param[in] column    Display column
+@param[in] previous  Row of previous sample
+@param[in] actual    Row of actual sample
+
+@return None
+*/
+/**************************************************************************/
+
+static void chart_column(const chart_t *chart, uint8_t column, uint8_t previous, uint8_t actual)
+{
+    oled_fillRect(column, chart->line * 8, column, chart->line * 8 + chart->lines * 8 - 1, BLACK);
+    oled_drawLine(column, previous, column, actual, WHITE);
+}
+
+/**************************************************************************/
+/*!
+@brief  Find minimum and maximum of kept samples
+
+@param[in] chart  Chart state
+
+@return None
+*/
+/**************************************************************************/
+
+static void chart_scale(chart_t *chart)
+{
+    uint8_t i = chart->head;
+
+    chart->min = chart->samples[i];
+    chart->max = chart->samples[i];
+    for (uint8_t n = 1; n < chart->count; n++) {
+        i = (i == 0) ? chart->width : i - 1;
+        if (chart->samples[i] < chart->min) chart->min = chart->samples[i];
+        if (chart->samples[i] > chart->max) chart->max = chart->samples[i];
+    }
+    chart->sinceRescale = 0;
+}
+
+void chart_init(chart_t *chart, uint8_t x, uint8_t line, uint8_t width, uint8_t lines)
+{
+    if (width > CHART_MAX_SAMPLES) width = CHART_MAX_SAMPLES;
+    chart->x = x;
+    chart->line = line;
+    chart->width = width;
+    chart->lines = lines;
+    chart->head = 0;
+    chart->count = 0;
+    chart->sinceRescale = 0;
+    chart->min = 0;
+    chart->max = 0;
+
+    oled_fillRect(x, line * 8, x + width - 1, line * 8 + lines * 8 - 1, BLACK);
+    for (uint8_t i = 0; i < lines; i++) {
+        oled_mark_dirty(x, line + i, width);
+    }
+}
+
+void chart_push(chart_t *chart, int16_t value)
+{
+    int16_t previous = chart->samples[chart->head];
+
+    chart->head = (chart->head == chart->width) ? 0 : chart->head + 1;
+    chart->samples[chart->head] = value;
+    if (chart->count <= chart->width) chart->count++;
+
+    /* Out of scale or scale may shrink: everything has to be redrawn */
+    if (chart->count == 1 || value < chart->min || value > chart->max ||
+        ++chart->sinceRescale >= CHART_RESCALE_PERIOD) {
+        chart_redraw(chart);
+        return;
+    }
+
+    /* Scroll by one column and draw only the new one */
+    for (uint8_t i = 0; i < chart->lines; i++) {
+        oled_shift_block(chart->x, chart->line + i, chart->width);
+    }
+    chart_column(chart, chart->x + chart->width - 1, chart_row(chart, previous), chart_row(chart, value));
+}
+
+void chart_redraw(chart_t *chart)
+{
+    uint8_t column = chart->x + chart->width - 1;
+    uint8_t i = chart->head;
+    uint8_t previous;
+
+    if (chart->count == 0) return;
+    chart_scale(chart);
+    oled_fillRect(chart->x, chart->line * 8, column, chart->line * 8 + chart->lines * 8 - 1, BLACK);
+
+    /* From the newest sample to the left, the oldest sample only connects */
+    for (uint8_t n = 0; n < chart->count && n < chart->width; n++, column--) {
+        uint8_t j = (i == 0) ? chart->width : i - 1;
+        uint8_t actual = chart_row(chart, chart->samples[i]);
+        previous = (n + 1 < chart->count) ? chart_row(chart, chart->samples[j]) : actual;
+        chart_column(chart, column, previous, actual);
+        i = j;
+    }
+    for (uint8_t k = 0; k < chart->lines; k++) {
+        oled_mark_dirty(chart->x, chart->line + k, chart->width);
+    }
+}
@@ -0,0 +1,89 @@
+/**************************************************************************/
+/*!
+@file     chart.h
+@brief    Header for incremental trend chart on the OLED display buffer
+*/
+/**************************************************************************/
+
+#ifndef CHART_H
+#define CHART_H
+
+#include <stdint.h>
+
+/// Maximal number of samples (= columns) kept by one chart
+#ifndef CHART_MAX_SAMPLES
+#define CHART_MAX_SAMPLES 60
+#endif
+
+/// Number of pushed samples after which the scale may shrink again
+#define CHART_RESCALE_PERIOD CHART_MAX_SAMPLES
+
+/**************************************************************************/
+/*!
+@brief  Trend chart state
+
+The chart occupies whole display lines (pages) so its columns can be
+scrolled by shifting buffer bytes. Samples are kept in a ring, the newest
+sample is drawn in the rightmost column.
+*/
+/**************************************************************************/
+
+typedef struct {
+    uint8_t x;              /*!< Left column of chart */
+    uint8_t line;           /*!< Top display line (page) of chart */
+    uint8_t width;          /*!< Width in columns, at most CHART_MAX_SAMPLES */
+    uint8_t lines;          /*!< Height in display lines (pages) */
+    int16_t samples[CHART_MAX_SAMPLES+1]; /*!< Ring of samples, one more than columns */
+    uint8_t head;           /*!< Index of newest sample */
+    uint8_t count;          /*!< Number of valid samples, at most width+1 */
+    uint8_t sinceRescale;   /*!< Samples pushed since last full rescale */
+    int16_t min;            /*!< Lower limit of actual scale */
+    int16_t max;            /*!< Upper limit of actual scale */
+} chart_t;
+
+/**************************************************************************/
+/*!
+@brief  Initialize chart and clear its area in the display buffer
+
+@param[in] chart  Chart state
+@param[in] x      Left column (0–127)
+@param[in] line   Top display line (0–7)
+@param[in] width  Width in columns (1–CHART_MAX_SAMPLES)
+@param[in] lines  Height in display lines (1–8)
+
+@return None
+*/
+/**************************************************************************/
+
+void chart_init(chart_t *chart, uint8_t x, uint8_t line, uint8_t width, uint8_t lines);
+
+/**************************************************************************/
+/*!
+@brief  Add sample to chart
+
+Scrolls the chart one column left and draws only the new column. The whole
+chart is redrawn only when the sample is out of the actual scale or the
+scale is due to shrink. Changed columns are marked for oled_display_dirty().
+
+@param[in] chart  Chart state
+@param[in] value  New sample
+
+@return None
+*/
+/**************************************************************************/
+
+void chart_push(chart_t *chart, int16_t value);
+
+/**************************************************************************/
+/*!
+@brief  Rescale to the kept samples and redraw the whole chart
+
+@param[in] chart  Chart state
+
+@return None
+*/
+/**************************************************************************/
+
+void chart_redraw(chart_t *chart);
+
+#endif
@@ -0,0 +1,137 @@
+/**************************************************************************/
+/*!
+@file     filter.c
+@brief    Streaming fixed-point filters (median, Hampel, EMA)
+@license  MIT
+
+All filters take one sample per call and keep their state in a few bytes
+of the caller. Median and Hampel filter sort a copy of their window by
+insertion, with FILTER_WINDOW samples that is at most 10 compare-and-swap
+steps per sort, so the cost per sample is bounded. The median absolute
+deviation is scaled by 3/2 instead of 1.4826 to estimate the standard
+deviation of normal noise. The moving average needs one subtraction,
+shift and addition per sample.
+*/
+/**************************************************************************/
+
+#include "filter.h"
+
+#if FILTER_WINDOW % 2 == 0 || FILTER_WINDOW > 15
+# error "FILTER_WINDOW has to be odd and at most 15"
+#endif
+
+/**************************************************************************/
+/*!
+@brief  Sort values ascending by insertion
+
+@param[in,out] values  Values
+@param[in]     count   Number of values
+
+@return None
+*/
+/**************************************************************************/
+
+static void filter_sort(uint16_t values[], uint8_t count)
+{
+    for (uint8_t i = 1; i < count; i++) {
+        uint16_t value = values[i];
+        uint8_t j = i;
+        while (j > 0 && values[j - 1] > value) {
+            values[j] = values[j - 1];
+            j--;
+        }
+        values[j] = value;
+    }
+}
+
+/**************************************************************************/
+/*!
+@brief  Distance of two samples, differences of int16 fit uint16
+*/
+/**************************************************************************/
+
+static uint16_t filter_distance(int16_t a, int16_t b)
+{
+    return (a > b) ? (uint16_t)a - (uint16_t)b : (uint16_t)b - (uint16_t)a;
+}
+
+/**************************************************************************/
+/*!
+@brief  Put sample into window and return median of window
+
+Samples are offset by 0x8000, so signed values sort as unsigned ones.
+*/
+/**************************************************************************/
+
+static int16_t filter_window(filter_median_t *filter, int16_t value)
+{
+    uint16_t sorted[FILTER_WINDOW];
+
+    filter->samples[filter->head] = value;
+    filter->head = (filter->head + 1 < FILTER_WINDOW) ? filter->head + 1 : 0;
+    if (filter->count < FILTER_WINDOW) filter->count++;
+
+    for (uint8_t i = 0; i < filter->count; i++) sorted[i] = (uint16_t)filter->samples[i] ^ 0x8000;
+    filter_sort(sorted, filter->count);
+    return (int16_t)(sorted[(filter->count - 1) / 2] ^ 0x8000);
+}
+
+void filter_median_init(filter_median_t *filter)
+{
+    filter->head = 0;
+    filter->count = 0;
+}
+
+int16_t filter_median(filter_median_t *filter, int16_t value)
+{
+    return filter_window(filter, value);
+}
+
+void filter_hampel_init(filter_hampel_t *filter, uint8_t k, uint8_t floor)
+{
+    filter_median_init(&filter->window);
+    filter->k = k;
+    filter->floor = floor;
+}
+
+int16_t filter_hampel(filter_hampel_t *filter, int16_t value)
+{
+    uint16_t deviations[FILTER_WINDOW];
+    uint8_t count;
+    int16_t median;
+    uint32_t threshold;
+
+    median = filter_window(&filter->window, value);
+    count = filter->window.count;
+    if (filter->k == 0 || count < 3) return value;
+
+    // median absolute deviation
+    for (uint8_t i = 0; i < count; i++) deviations[i] = filter_distance(filter->window.samples[i], median);
+    filter_sort(deviations, count);
+    threshold = ((uint32_t)deviations[(count - 1) / 2] * filter->k * 3 + 1) / 2;
+    if (threshold < filter->floor) threshold = filter->floor;
+
+    return (filter_distance(value, median) > threshold) ? median : value;
+}
+
+void filter_ema_init(filter_ema_t *filter, uint8_t shift)
+{
+    filter->average = 0;
+    filter->shift = shift;
+    filter->primed = 0;
+}
+
+int16_t filter_ema(filter_ema_t *filter, int16_t value)
+{
+    int32_t sample = (int32_t)value * (1L << FILTER_EMA_FRAC);
+    uint8_t shift = (filter->shift < FILTER_EMA_FRAC) ? filter->shift : FILTER_EMA_FRAC;
+
+    if (!filter->primed) {
+        filter->average = sample;
+        filter->primed = 1;
+    } else {
+        // arithmetic shift, difference of int16 samples fits FILTER_EMA_FRAC+17 bits
+        filter->average += (sample - filter->average) >> shift;
+    }
+    return (int16_t)((filter->average + (1L << (FILTER_EMA_FRAC - 1))) >> FILTER_EMA_FRAC);
+}
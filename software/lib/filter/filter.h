@@ -0,0 +1,147 @@
+/**************************************************************************/
+/*!
+@file     filter.h
+@brief    Header for streaming fixed-point filters (median, Hampel, EMA)
+*/
+/**************************************************************************/
+
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <stdint.h>
+
+/// Samples in window of median and Hampel filter, odd
+#ifndef FILTER_WINDOW
+#define FILTER_WINDOW 5
+#endif
+
+/// Fraction bits of exponential moving average
+#define FILTER_EMA_FRAC 14
+
+/**************************************************************************/
+/*!
+@brief  Median filter state, ring of the last FILTER_WINDOW samples
+*/
+/**************************************************************************/
+
+typedef struct {
+    int16_t samples[FILTER_WINDOW]; /*!< Ring of samples */
+    uint8_t head;           /*!< Index of next sample */
+    uint8_t count;          /*!< Number of valid samples, at most FILTER_WINDOW */
+} filter_median_t;
+
+/**************************************************************************/
+/*!
+@brief  Hampel filter state
+
+A sample further than k times the scaled median absolute deviation (MAD)
+from the median of the window is an outlier and replaced by the median.
+*/
+/**************************************************************************/
+
+typedef struct {
+    filter_median_t window; /*!< Raw samples including outliers */
+    uint8_t k;              /*!< Threshold in scaled MADs, 0 disables the filter */
+    uint8_t floor;          /*!< Lowest threshold, keeps noise of a flat signal */
+} filter_hampel_t;
+
+/**************************************************************************/
+/*!
+@brief  Exponential moving average state
+*/
+/**************************************************************************/
+
+typedef struct {
+    int32_t average;        /*!< Average with FILTER_EMA_FRAC fraction bits */
+    uint8_t shift;          /*!< Alpha is 2^-shift, 0 passes samples through */
+    uint8_t primed;         /*!< First sample was taken */
+} filter_ema_t;
+
+/**************************************************************************/
+/*!
+@brief  Initialize median filter
+
+@param[in] filter  Filter state
+
+@return None
+*/
+/**************************************************************************/
+
+void filter_median_init(filter_median_t *filter);
+
+/**************************************************************************/
+/*!
+@brief  Add sample to median filter
+
+Until the window is full the median of the samples so far is returned.
+
+@param[in] filter  Filter state
+@param[in] value   New sample
+
+@return Median of the last FILTER_WINDOW samples
+*/
+/**************************************************************************/
+
+int16_t filter_median(filter_median_t *filter, int16_t value);
+
+/**************************************************************************/
+/*!
+@brief  Initialize Hampel filter
+
+@param[in] filter  Filter state
+@param[in] k       Threshold in scaled MADs, typically 3
+@param[in] floor   Lowest threshold in units of the samples
+
+@return None
+*/
+/**************************************************************************/
+
+void filter_hampel_init(filter_hampel_t *filter, uint8_t k, uint8_t floor);
+
+/**************************************************************************/
+/*!
+@brief  Add sample to Hampel filter
+
+The window is causal, it ends with the new sample, so an outlier is
+caught without delay. A step of the signal passes once it fills more than
+half of the window.
+
+@param[in] filter  Filter state
+@param[in] value   New sample
+
+@return Sample, or median of the window if the sample is an outlier
+*/
+/**************************************************************************/
+
+int16_t filter_hampel(filter_hampel_t *filter, int16_t value);
+
+/**************************************************************************/
+/*!
+@brief  Initialize exponential moving average
+
+@param[in] filter  Filter state
+@param[in] shift   Alpha is 2^-shift (0–FILTER_EMA_FRAC)
+
+@return None
+*/
+/**************************************************************************/
+
+void filter_ema_init(filter_ema_t *filter, uint8_t shift);
+
+/**************************************************************************/
+/*!
+@brief  Add sample to exponential moving average
+
+The first sample sets the average. A change of shift takes effect with
+the next sample, the average is kept.
+
+@param[in] filter  Filter state
+@param[in] value   New sample
+
+@return Rounded average
+*/
+/**************************************************************************/
+
+int16_t filter_ema(filter_ema_t *filter, int16_t value);
+
+#endif
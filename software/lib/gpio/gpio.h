@@ -27,6 +27,32 @@
 #include <avr/io.h>
 
 
+// -- Pin macros -----------------------------------------------------
+/**
+ * @brief  Pins known at compile time, port letter and pin number.
+ * @details A pin is given by its port letter and number, such as
+ *          GPIO_CLEAR(B, PB0), or by a descriptor macro expanding to both,
+ *          such as `#define LED_IO B, PB0` and GPIO_CLEAR(LED_IO). Ports
+ *          of ATmega328P are in the bit-addressable I/O space, so set,
+ *          clear and toggle compile to a single sbi or cbi instruction and
+ *          a test of GPIO_READ() to sbis or sbic, without a call. Use them
+ *          in interrupt service routines, the functions below take any
+ *          register at run time.
+ */
+#define GPIO_MODE_OUTPUT(...)  GPIO_MODE_OUTPUT_(__VA_ARGS__)
+#define GPIO_SET(...)          GPIO_SET_(__VA_ARGS__)
+#define GPIO_CLEAR(...)        GPIO_CLEAR_(__VA_ARGS__)
+#define GPIO_TOGGLE(...)       GPIO_TOGGLE_(__VA_ARGS__)
+#define GPIO_READ(...)         GPIO_READ_(__VA_ARGS__)
+
+// Second level expands a descriptor macro into port and pin first
+#define GPIO_MODE_OUTPUT_(port, pin)  (DDR##port |= (1 << (pin)))
+#define GPIO_SET_(port, pin)          (PORT##port |= (1 << (pin)))
+#define GPIO_CLEAR_(port, pin)        (PORT##port &= ~(1 << (pin)))
+#define GPIO_TOGGLE_(port, pin)       (PIN##port = (1 << (pin)))  /*!< Writing 1 to PINx toggles */
+#define GPIO_READ_(port, pin)         (!!(PIN##port & (1 << (pin))))  /*!< Bit test, not a shift */
+
+
 // -- Function prototypes --------------------------------------------
 /**
  * @brief  Configure one output pin.
@@ -0,0 +1,258 @@
+/**************************************************************************/
+/*!
+@file     history.c
+@brief    SRAM history of periodic aggregates with delta encoding
+@license  MIT
+
+Records of periodic aggregates (minute means from lib/stats) are stored
+in a byte ring. Every record starts with a header byte:
+
+- bit 7 set: keyframe, absolute values of all channels follow
+- bits 0–3: delta record, deltas of the channels with set bits follow
+- bits 4–6: with bits 0–3 clear, the previous record repeats 1–8 times
+
+Values and deltas are zig-zag encoded varints (7 bits per byte), so a
+slowly changing channel costs one byte and an unchanged one nothing. A
+keyframe starts every HISTORY_KEYFRAME records, when the ring is full the
+oldest block (keyframe and its delta records) is dropped, so decoding
+always starts at a keyframe.
+*/
+/**************************************************************************/
+
+#include "history.h"
+#include <string.h>
+
+#if HISTORY_SIZE > 255
+# error "HISTORY_SIZE is limited to 255 bytes"
+#endif
+
+/// Header bits
+#define HISTORY_KEY     0x80
+#define HISTORY_MASK    0x0F
+#define HISTORY_REPEAT  0x70
+
+/// Longest record: header and three varint bytes per channel
+#define HISTORY_RECORD_MAX (1 + 3 * HISTORY_CHANNELS)
+
+/**************************************************************************/
+/*!
+@brief  History state
+*/
+/**************************************************************************/
+
+static struct {
+    uint8_t ring[HISTORY_SIZE];     /*!< Encoded records */
+    uint8_t tail;                   /*!< Position of oldest keyframe */
+    uint8_t used;                   /*!< Bytes in ring */
+    uint8_t key;                    /*!< Position of newest keyframe */
+    uint8_t repeat;                 /*!< Position+1 of newest header if it can repeat, else 0 */
+    uint8_t sinceKey;               /*!< Records since newest keyframe */
+    uint8_t drops;                  /*!< Dropped blocks, wraps around */
+    uint16_t count;                 /*!< Stored records */
+    int16_t last[HISTORY_CHANNELS]; /*!< Values of newest record */
+} history;
+
+/**************************************************************************/
+/*!
+@brief  Ring position after pos
+*/
+/**************************************************************************/
+
+static uint8_t history_next(uint8_t pos)
+{
+    return (pos + 1 < HISTORY_SIZE) ? pos + 1 : 0;
+}
+
+/**************************************************************************/
+/*!
+@brief  Ring position of byte offset after tail
+*/
+/**************************************************************************/
+
+static uint8_t history_pos(uint8_t offset)
+{
+    uint16_t pos = history.tail + offset;
+
+    return (pos < HISTORY_SIZE) ? pos : pos - HISTORY_SIZE;
+}
+
+/**************************************************************************/
+/*!
+@brief  Encode zig-zag varint
+
+@param[out] out    Output, at least 3 bytes
+@param[in]  value  Value
+
+@return Bytes written
+*/
+/**************************************************************************/
+
+static uint8_t history_varint(uint8_t *out, int16_t value)
+{
+    uint16_t zigzag = ((uint16_t)value << 1) ^ (uint16_t)(value >> 15);
+    uint8_t size = 0;
+
+    while (zigzag >= 0x80) {
+        out[size++] = zigzag | 0x80;
+        zigzag >>= 7;
+    }
+    out[size++] = zigzag;
+    return size;
+}
+
+/**************************************************************************/
+/*!
+@brief  Decode zig-zag varint from ring
+
+@param[in,out] pos   Ring position, moved behind the varint
+@param[in,out] left  Bytes left, decremented
+
+@return Value
+*/
+/**************************************************************************/
+
+static int16_t history_unvarint(uint8_t *pos, uint8_t *left)
+{
+    uint16_t zigzag = 0;
+    uint8_t shift = 0;
+    uint8_t byte;
+
+    do {
+        byte = history.ring[*pos];
+        *pos = history_next(*pos);
+        (*left)--;
+        zigzag |= (uint16_t)(byte & 0x7F) << shift;
+        shift += 7;
+    } while ((byte & 0x80) && *left != 0);
+    return (zigzag >> 1) ^ -(zigzag & 1);
+}
+
+/**************************************************************************/
+/*!
+@brief  Decode record at pos and apply it to values
+
+@param[in,out] pos     Ring position of header, moved behind the record
+@param[in,out] left    Bytes left, decremented
+@param[in,out] values  Values of previous record, updated
+
+@return Number of records (repeats) of header
+*/
+/**************************************************************************/
+
+static uint8_t history_decode(uint8_t *pos, uint8_t *left, int16_t values[HISTORY_CHANNELS])
+{
+    uint8_t header = history.ring[*pos];
+
+    *pos = history_next(*pos);
+    (*left)--;
+    for (uint8_t i = 0; i < HISTORY_CHANNELS; i++) {
+        if (header & HISTORY_KEY) {
+            values[i] = history_unvarint(pos, left);
+        } else if (header & (1 << i)) {
+            values[i] += history_unvarint(pos, left);
+        }
+    }
+    if ((header & (HISTORY_KEY | HISTORY_MASK)) == 0) {
+        return ((header & HISTORY_REPEAT) >> 4) + 1;
+    }
+    return 1;
+}
+
+/**************************************************************************/
+/*!
+@brief  Drop oldest block, keyframe and its delta records
+
+@return None
+*/
+/**************************************************************************/
+
+static void history_drop(void)
+{
+    int16_t values[HISTORY_CHANNELS];
+    uint8_t pos = history.tail;
+    uint8_t left = history.used;
+
+    do {
+        history.count -= history_decode(&pos, &left, values);
+    } while (left != 0 && !(history.ring[pos] & HISTORY_KEY));
+    history.tail = pos;
+    history.used = left;
+    history.drops++;
+}
+
+void history_add(const int16_t values[HISTORY_CHANNELS])
+{
+    uint8_t record[HISTORY_RECORD_MAX];
+    uint8_t size = 1;
+    uint8_t pos;
+
+    if (history.used != 0 && history.sinceKey < HISTORY_KEYFRAME) {
+        // delta record, unchanged record extends repeat header in place
+        record[0] = 0;
+        for (uint8_t i = 0; i < HISTORY_CHANNELS; i++) {
+            if (values[i] != history.last[i]) {
+                record[0] |= 1 << i;
+                size += history_varint(&record[size], values[i] - history.last[i]);
+            }
+        }
+        if (record[0] == 0 && history.repeat != 0 &&
+            (history.ring[history.repeat - 1] & HISTORY_REPEAT) != HISTORY_REPEAT) {
+            history.ring[history.repeat - 1] += 0x10;
+            history.sinceKey++;
+            history.count++;
+            return;
+        }
+        // block of newest keyframe would be dropped, start a new one
+        while (HISTORY_SIZE - history.used < size && history.tail != history.key) {
+            history_drop();
+        }
+    }
+    if (HISTORY_SIZE - history.used < size || history.used == 0 || history.sinceKey >= HISTORY_KEYFRAME) {
+        record[0] = HISTORY_KEY;
+        size = 1;
+        for (uint8_t i = 0; i < HISTORY_CHANNELS; i++) {
+            size += history_varint(&record[size], values[i]);
+        }
+        while (HISTORY_SIZE - history.used < size) history_drop();
+        history.key = history_pos(history.used);
+        history.sinceKey = 0;
+    }
+
+    pos = history_pos(history.used);
+    history.repeat = (record[0] == 0) ? pos + 1 : 0;
+    for (uint8_t i = 0; i < size; i++) {
+        history.ring[pos] = record[i];
+        pos = history_next(pos);
+    }
+    history.used += size;
+    history.sinceKey++;
+    history.count++;
+    memcpy(history.last, values, sizeof(history.last));
+}
+
+
+uint16_t history_count(void)
+{
+    return history.count;
+}
+
+void history_iter_init(history_iter_t *iter)
+{
+    iter->index = 0xFFFF;
+    iter->pos = history.tail;
+    iter->left = history.used;
+    iter->repeat = 0;
+    iter->drops = history.drops;
+}
+
+uint8_t history_iter_next(history_iter_t *iter)
+{
+    if (iter->drops != history.drops) return 0;   // block of iterator was dropped
+    if (iter->repeat == 0) {
+        if (iter->left == 0) return 0;
+        iter->repeat = history_decode(&iter->pos, &iter->left, iter->values);
+    }
+    iter->repeat--;
+    iter->index++;
+    return 1;
+}
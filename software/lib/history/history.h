@@ -0,0 +1,90 @@
+/**************************************************************************/
+/*!
+@file     history.h
+@brief    Header for SRAM history of periodic aggregates with delta encoding
+*/
+/**************************************************************************/
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stdint.h>
+
+/// Number of channels of a record
+#define HISTORY_CHANNELS 4
+
+/// Bytes of encoded history ring (at most 255)
+#ifndef HISTORY_SIZE
+#define HISTORY_SIZE 96
+#endif
+
+/// Records from one keyframe to the next
+#ifndef HISTORY_KEYFRAME
+#define HISTORY_KEYFRAME 16
+#endif
+
+/**************************************************************************/
+/*!
+@brief  Iterator over stored records, oldest first
+*/
+/**************************************************************************/
+
+typedef struct {
+    int16_t values[HISTORY_CHANNELS]; /*!< Values of actual record */
+    uint16_t index;     /*!< Index of actual record, 0 is the oldest */
+    uint8_t pos;        /*!< Ring position of next header */
+    uint8_t left;       /*!< Bytes left to decode */
+    uint8_t repeat;     /*!< Repetitions of actual record left */
+    uint8_t drops;      /*!< Dropped blocks at start, see history_iter_next() */
+} history_iter_t;
+
+/**************************************************************************/
+/*!
+@brief  Store record, e.g. the means of a minute
+
+@param[in] values  Values of all channels
+
+@return None
+*/
+/**************************************************************************/
+
+void history_add(const int16_t values[HISTORY_CHANNELS]);
+
+/**************************************************************************/
+/*!
+@brief  Number of stored records
+
+@return Records
+*/
+/**************************************************************************/
+
+uint16_t history_count(void);
+
+/**************************************************************************/
+/*!
+@brief  Start iteration at the oldest record
+
+Records stored during the iteration may not be visited, records dropped
+during the iteration end it.
+
+@param[out] iter  Iterator
+
+@return None
+*/
+/**************************************************************************/
+
+void history_iter_init(history_iter_t *iter);
+
+/**************************************************************************/
+/*!
+@brief  Decode next record into iter->values
+
+@param[in,out] iter  Iterator
+
+@return 1 if a record was decoded, 0 at the end
+*/
+/**************************************************************************/
+
+uint8_t history_iter_next(history_iter_t *iter);
+
+#endif
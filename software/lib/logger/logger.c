@@ -0,0 +1,244 @@
+/**************************************************************************/
+/*!
+@file     logger.c
+@brief    Wear-leveled EEPROM log of hourly aggregates
+@license  MIT
+
+Records of minimum, mean and maximum per channel fill the EEPROM as a
+ring of fixed slots. Record with sequence number n goes to slot n modulo
+the number of slots, so every slot is rewritten once per lap of the ring:
+with 36 slots of 28 bytes and one record per hour a cell sees one write
+in 36 hours, far below the endurance of 100 000 cycles. Bytes that do not
+change are not written at all.
+
+Inside a lap the sequence numbers of slots 0 to the newest one grow by
+one per slot, slots behind it hold the previous lap or are erased. The
+newest record is therefore found by a binary search for the end of that
+run. Writes go from the last byte to the first, a record torn by a power
+loss keeps the old sequence number, so the search skips it. The slot of
+the next record is never read back: after a power loss it may hold a torn
+record whose CRC happens to match, so the log holds one record less than
+it has slots.
+*/
+/**************************************************************************/
+
+#include "logger.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/crc16.h>
+#include <stddef.h>
+
+/// Sequence numbers wrap at a multiple of slots, 0xFFFF marks erased EEPROM
+#define LOGGER_SEQUENCES ((0xFFFFU / LOGGER_SLOTS) * LOGGER_SLOTS)
+
+/// EEPROM record of slot
+#define LOGGER_RECORD(slot) ((const logger_record_t *)(LOGGER_EEPROM_START + (slot) * sizeof(logger_record_t)))
+
+_Static_assert(LOGGER_SLOTS >= 2 && LOGGER_SLOTS <= 255, "Logger needs 2 to 255 slots");
+
+/**************************************************************************/
+/*!
+@brief  Logger state
+*/
+/**************************************************************************/
+
+static struct {
+    logger_record_t record;         /*!< Record being written */
+    uint8_t slot;                   /*!< Slot of next record */
+    uint8_t count;                  /*!< Records in EEPROM */
+    uint8_t left;                   /*!< Bytes of record not written yet */
+    volatile uint8_t busy;          /*!< Record being written, cleared by interrupt */
+} logger;
+
+/**************************************************************************/
+/*!
+@brief  Sequence number of slot, EEPROM must be idle
+
+@param[in] slot  Slot
+
+@return Sequence number as stored
+*/
+/**************************************************************************/
+
+static uint16_t logger_sequence(uint8_t slot)
+{
+    return eeprom_read_word(&LOGGER_RECORD(slot)->sequence);
+}
+
+/**************************************************************************/
+/*!
+@brief  Check CRC of slot, EEPROM must be idle
+
+@param[in] slot  Slot
+
+@return 1 if slot holds a valid record, 0 otherwise
+*/
+/**************************************************************************/
+
+static uint8_t logger_valid(uint8_t slot)
+{
+    const uint8_t *address = (const uint8_t *)LOGGER_RECORD(slot);
+    uint16_t crc = 0xFFFF;
+
+    if (logger_sequence(slot) == 0xFFFF) return 0;
+    for (uint8_t i = 0; i < offsetof(logger_record_t, crc); i++) {
+        crc = _crc16_update(crc, eeprom_read_byte(address + i));
+    }
+    return crc == eeprom_read_word(&LOGGER_RECORD(slot)->crc);
+}
+
+void logger_init(void)
+{
+    const uint8_t slots = LOGGER_SLOTS;    // size_t constant, checked to fit above
+    uint8_t newest;
+    uint8_t low = 0;
+    uint8_t high = slots;
+    uint16_t first;
+
+    EECR &= ~((1 << EERIE) | (1 << EEPM1) | (1 << EEPM0));
+    logger.busy = 0;
+    eeprom_busy_wait();
+
+    if (logger_valid(0)) {
+        // last slot of the run of sequence numbers that started at slot 0
+        first = logger_sequence(0);
+        while (high - low > 1) {
+            uint8_t middle = (low + high) / 2;
+            if (logger_sequence(middle) == first + middle) {
+                low = middle;
+            } else {
+                high = middle;
+            }
+        }
+        newest = low;
+        while (!logger_valid(newest)) newest--;
+    } else if (logger_valid(slots - 1)) {
+        // write of slot 0 was torn, previous lap is complete
+        newest = slots - 1;
+    } else {
+        logger.record.sequence = 0;
+        logger.slot = 0;
+        logger.count = 0;
+        return;
+    }
+
+    logger.record.sequence = (logger_sequence(newest) + 1) % LOGGER_SEQUENCES;
+    logger.slot = (newest + 1) % slots;
+    logger.count = logger_valid(slots - 1) ? slots - 1 : newest + 1;
+}
+
+void logger_add(const int16_t min[LOGGER_CHANNELS], const int16_t mean[LOGGER_CHANNELS],
+                const int16_t max[LOGGER_CHANNELS])
+{
+    const uint8_t *data = (const uint8_t *)&logger.record;
+    uint16_t crc = 0xFFFF;
+
+    while (logger.busy);            // previous record still being written
+
+    for (uint8_t i = 0; i < LOGGER_CHANNELS; i++) {
+        logger.record.min[i] = min[i];
+        logger.record.mean[i] = mean[i];
+        logger.record.max[i] = max[i];
+    }
+    for (uint8_t i = 0; i < offsetof(logger_record_t, crc); i++) crc = _crc16_update(crc, data[i]);
+    logger.record.crc = crc;
+
+    logger.left = sizeof(logger_record_t);
+    logger.busy = 1;
+    EECR |= (1 << EERIE);
+}
+
+/**************************************************************************/
+/*!
+@brief  EEPROM ready, write next changed byte of record, last byte first
+*/
+/**************************************************************************/
+
+ISR(EE_READY_vect)
+{
+    const uint8_t *data = (const uint8_t *)&logger.record;
+    uint16_t address = LOGGER_EEPROM_START + logger.slot * sizeof(logger_record_t);
+    uint8_t i = logger.left;
+
+    while (i != 0) {
+        i--;
+        EEAR = address + i;
+        EECR |= (1 << EERE);
+        if (EEDR != data[i]) {
+            EEDR = data[i];
+            EECR |= (1 << EEMPE);
+            EECR |= (1 << EEPE);
+            logger.left = i;
+            return;
+        }
+    }
+
+    // record complete
+    logger.record.sequence = (logger.record.sequence + 1) % LOGGER_SEQUENCES;
+    logger.slot = (logger.slot + 1) % LOGGER_SLOTS;
+    if (logger.count < LOGGER_SLOTS - 1) logger.count++;
+    logger.busy = 0;
+    EECR &= ~(1 << EERIE);
+}
+
+/**************************************************************************/
+/*!
+@brief  Pause background write and wait for EEPROM, its interrupt would move EEAR
+*/
+/**************************************************************************/
+
+static void logger_pause(void)
+{
+    uint8_t sreg = SREG;
+
+    cli();
+    EECR &= ~(1 << EERIE);
+    SREG = sreg;
+    eeprom_busy_wait();
+}
+
+/**************************************************************************/
+/*!
+@brief  Resume background write paused by logger_pause()
+
+The interrupt is off, so busy can't change until it is enabled again.
+*/
+/**************************************************************************/
+
+static void logger_resume(void)
+{
+    if (logger.busy) EECR |= (1 << EERIE);
+}
+
+uint16_t logger_count(void)
+{
+    return logger.count;
+}
+
+uint8_t logger_read(uint16_t age, uint8_t channel, int16_t values[3])
+{
+    const logger_record_t *record;
+    uint8_t slot;
+    uint8_t valid = 0;
+
+    logger_pause();
+    if (age < logger.count && channel < LOGGER_CHANNELS) {
+        slot = (logger.slot + LOGGER_SLOTS - 1 - age) % LOGGER_SLOTS;
+        record = LOGGER_RECORD(slot);
+        if (logger_valid(slot)) {
+            values[0] = eeprom_read_word((const uint16_t *)&record->min[channel]);
+            values[1] = eeprom_read_word((const uint16_t *)&record->mean[channel]);
+            values[2] = eeprom_read_word((const uint16_t *)&record->max[channel]);
+            valid = 1;
+        }
+    }
+    logger_resume();
+    return valid;
+}
+
+void logger_read_slot(uint8_t slot, logger_record_t *record)
+{
+    logger_pause();
+    eeprom_read_block(record, LOGGER_RECORD(slot), sizeof(*record));
+    logger_resume();
+}
@@ -0,0 +1,120 @@
+/**************************************************************************/
+/*!
+@file     logger.h
+@brief    Header for wear-leveled EEPROM log of hourly aggregates
+*/
+/**************************************************************************/
+
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <stdint.h>
+#include <avr/eeprom.h>
+
+/// Number of channels of a record
+#define LOGGER_CHANNELS 4
+
+/// First EEPROM byte of the log
+#ifndef LOGGER_EEPROM_START
+#define LOGGER_EEPROM_START 0
+#endif
+
+/// EEPROM bytes of the log, the whole EEPROM by default
+#ifndef LOGGER_EEPROM_SIZE
+#define LOGGER_EEPROM_SIZE (E2END + 1 - LOGGER_EEPROM_START)
+#endif
+
+/**************************************************************************/
+/*!
+@brief  Record of one period as stored in EEPROM
+
+Sequence number n is stored in slot n modulo the number of slots, the
+CRC is CRC-16/MODBUS of all bytes before it.
+*/
+/**************************************************************************/
+
+typedef struct {
+    uint16_t sequence;                  /*!< Record number, wraps at a multiple of slots */
+    int16_t min[LOGGER_CHANNELS];       /*!< Lowest sample of period */
+    int16_t mean[LOGGER_CHANNELS];      /*!< Rounded mean of period */
+    int16_t max[LOGGER_CHANNELS];       /*!< Highest sample of period */
+    uint16_t crc;                       /*!< CRC-16 of record */
+} logger_record_t;
+
+/// Number of record slots, the log holds one record less
+#define LOGGER_SLOTS (LOGGER_EEPROM_SIZE / sizeof(logger_record_t))
+
+/**************************************************************************/
+/*!
+@brief  Find newest valid record and continue the log behind it
+
+Needs O(log n) EEPROM reads. A record torn by a power loss during its
+write is skipped.
+
+@return None
+*/
+/**************************************************************************/
+
+void logger_init(void);
+
+/**************************************************************************/
+/*!
+@brief  Write record of a period, e.g. the aggregates of an hour
+
+The record is written in the background by the EEPROM ready interrupt,
+a byte every 3.4 ms, unchanged bytes are skipped. A record that arrives
+before the previous one is written (about 100 ms) waits for it.
+
+@param[in] min   Lowest samples of all channels
+@param[in] mean  Means of all channels
+@param[in] max   Highest samples of all channels
+
+@return None
+*/
+/**************************************************************************/
+
+void logger_add(const int16_t min[LOGGER_CHANNELS], const int16_t mean[LOGGER_CHANNELS],
+                const int16_t max[LOGGER_CHANNELS]);
+
+/**************************************************************************/
+/*!
+@brief  Number of records in EEPROM
+
+@return Records, at most LOGGER_SLOTS-1
+*/
+/**************************************************************************/
+
+uint16_t logger_count(void);
+
+/**************************************************************************/
+/*!
+@brief  Read aggregates of one channel of a stored record
+
+@param[in]  age      Records before the newest one, 0 is the newest
+@param[in]  channel  Channel (0 to LOGGER_CHANNELS-1)
+@param[out] values   Minimum, mean and maximum
+
+@return 1 if the record is valid, 0 if it is missing or fails CRC
+*/
+/**************************************************************************/
+
+uint8_t logger_read(uint16_t age, uint8_t channel, int16_t values[3]);
+
+/**************************************************************************/
+/*!
+@brief  Copy slot from EEPROM as it is, without any check
+
+The record may be invalid, torn or older than its neighbours. A reader
+of all slots takes the valid record with the highest sequence number
+(modulo wrap) as the newest and ignores the slot after it.
+
+@param[in]  slot    Slot (0 to LOGGER_SLOTS-1)
+@param[out] record  Copy of slot
+
+@return None
+*/
+/**************************************************************************/
+
+void logger_read_slot(uint8_t slot, logger_record_t *record);
+
+#endif
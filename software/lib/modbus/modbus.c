@@ -0,0 +1,370 @@
+/**************************************************************************/
+/*!
+@file     modbus.c
+@brief    Modbus RTU slave over UART
+@license  MIT
+
+RTU frames are separated by 3.5 character times of silence. Every
+received byte restarts Timer0 from the UART receive interrupt, the
+compare match after t3.5 closes the frame and hands its length to the
+main loop. Bytes stay in the UART receive ring until modbus_poll() reads
+and checks them with CRC-16/MODBUS. Supported functions:
+
+- 03 read holding registers (shell parameters)
+- 04 read input registers (live sample structure)
+- 06 write single holding register
+
+Above 19200 Bd fixed gaps of 1750 us are used, as the specification
+recommends. The t1.5 inter-character limit is not checked.
+*/
+/**************************************************************************/
+
+#include "modbus.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <uart.h>
+#include <util/crc16.h>
+#include <string.h>
+
+/// Bytes of a request of the supported functions, address to CRC
+#define MODBUS_REQUEST_SIZE 8
+
+/// Frame gap above 19200 Bd in us
+#define MODBUS_GAP_FAST 1750
+
+/**************************************************************************/
+/*!
+@brief  Slave state
+*/
+/**************************************************************************/
+
+static struct {
+    const uint8_t *input;           /*!< Input register bytes */
+    uint8_t inputSize;              /*!< Bytes of input registers */
+    const shell_param_t *holding;   /*!< Holding registers, parameter table in flash */
+    uint8_t holdingCount;           /*!< Number of holding registers */
+    uint8_t address;                /*!< Slave address, 0 if disabled */
+    volatile uint8_t received;      /*!< Bytes of frame being received */
+    volatile uint8_t frameSize;     /*!< Bytes of complete frames waiting in UART ring */
+    uint8_t frame[MODBUS_REQUEST_SIZE]; /*!< Start of request */
+    uint16_t crc;                   /*!< CRC of reply */
+    modbus_stats_t stats;           /*!< Counters */
+} modbus;
+
+/**************************************************************************/
+/*!
+@brief  Put reply byte into UART transmit ring and update CRC
+
+@param[in] byte  Byte
+
+@return None
+*/
+/**************************************************************************/
+
+static void modbus_put(uint8_t byte)
+{
+    modbus.crc = _crc16_update(modbus.crc, byte);
+    uart_putc(byte);
+}
+
+/**************************************************************************/
+/*!
+@brief  Put 16-bit reply value, high byte first
+
+@param[in] value  Value
+
+@return None
+*/
+/**************************************************************************/
+
+static void modbus_put16(uint16_t value)
+{
+    modbus_put(value >> 8);
+    modbus_put(value);
+}
+
+/**************************************************************************/
+/*!
+@brief  Start reply with address and function code
+
+@param[in] function  Function code
+
+@return None
+*/
+/**************************************************************************/
+
+static void modbus_reply(uint8_t function)
+{
+    modbus.crc = 0xFFFF;
+    modbus_put(modbus.address);
+    modbus_put(function);
+}
+
+/**************************************************************************/
+/*!
+@brief  Finish reply with CRC, low byte first
+
+@return None
+*/
+/**************************************************************************/
+
+static void modbus_reply_end(void)
+{
+    uint16_t crc = modbus.crc;
+
+    uart_putc(crc);
+    uart_putc(crc >> 8);
+}
+
+/**************************************************************************/
+/*!
+@brief  Send exception reply
+
+@param[in] code  Exception code
+
+@return None
+*/
+/**************************************************************************/
+
+static void modbus_exception(uint8_t code)
+{
+    modbus.stats.exceptions++;
+    modbus_reply(modbus.frame[1] | 0x80);
+    modbus_put(code);
+    modbus_reply_end();
+}
+
+/**************************************************************************/
+/*!
+@brief  Read holding register
+
+@param[in] param  Copy of parameter entry
+
+@return Value, float rounded and saturated to 0..0xFFFF
+*/
+/**************************************************************************/
+
+static uint16_t modbus_holding_read(const shell_param_t *param)
+{
+    float value;
+
+    switch (param->type) {
+    case SHELL_U8:
+        return *(uint8_t *)param->value;
+    case SHELL_U16:
+        return *(uint16_t *)param->value;
+    default:
+        // conversion of a float out of range is undefined, NaN reads 0
+        value = *(float *)param->value;
+        if (!(value > 0.0f)) return 0;
+        if (value >= 65534.5f) return 0xFFFF;
+        return value + 0.5f;
+    }
+}
+
+/**************************************************************************/
+/*!
+@brief  Functions 03 and 04, read holding or input registers
+
+@return None
+*/
+/**************************************************************************/
+
+static void modbus_read(void)
+{
+    uint16_t start = (modbus.frame[2] << 8) | modbus.frame[3];
+    uint16_t quantity = (modbus.frame[4] << 8) | modbus.frame[5];
+    uint16_t count = (modbus.frame[1] == 0x04) ? (modbus.inputSize + 1) / 2 : modbus.holdingCount;
+    shell_param_t param;
+
+    if (quantity == 0 || quantity > MODBUS_MAX_QUANTITY) {
+        modbus_exception(MODBUS_ILLEGAL_VALUE);
+        return;
+    }
+    if (start >= count || quantity > count - start) {
+        modbus_exception(MODBUS_ILLEGAL_ADDRESS);
+        return;
+    }
+    modbus_reply(modbus.frame[1]);
+    modbus_put(quantity * 2);
+    for (uint16_t i = start; i < start + quantity; i++) {
+        if (modbus.frame[1] == 0x04) {
+            // bytes of the structure as they are, past its end reads zero
+            modbus_put(2 * i + 1 < modbus.inputSize ? modbus.input[2 * i + 1] : 0);
+            modbus_put(modbus.input[2 * i]);
+        } else {
+            memcpy_P(&param, &modbus.holding[i], sizeof(param));
+            modbus_put16(modbus_holding_read(&param));
+        }
+    }
+    modbus_reply_end();
+}
+
+/**************************************************************************/
+/*!
+@brief  Function 06, write single holding register
+
+@param[in] broadcast  Request has broadcast address, no reply
+
+@return None
+*/
+/**************************************************************************/
+
+static void modbus_write(uint8_t broadcast)
+{
+    uint16_t index = (modbus.frame[2] << 8) | modbus.frame[3];
+    uint16_t value = (modbus.frame[4] << 8) | modbus.frame[5];
+    shell_param_t param;
+
+    if (index >= modbus.holdingCount) {
+        if (!broadcast) modbus_exception(MODBUS_ILLEGAL_ADDRESS);
+        return;
+    }
+    memcpy_P(&param, &modbus.holding[index], sizeof(param));
+    if (value < param.min || value > param.max) {
+        if (!broadcast) modbus_exception(MODBUS_ILLEGAL_VALUE);
+        return;
+    }
+    switch (param.type) {
+    case SHELL_U8:
+        *(uint8_t *)param.value = value;
+        break;
+    case SHELL_U16:
+        *(uint16_t *)param.value = value;
+        break;
+    default:
+        *(float *)param.value = value;
+        break;
+    }
+    if (!broadcast) {
+        // echo of request, sent before the change may disable the slave
+        modbus.crc = 0xFFFF;
+        for (uint8_t i = 0; i < MODBUS_REQUEST_SIZE - 2; i++) modbus_put(modbus.frame[i]);
+        modbus_reply_end();
+    }
+    if (param.changed != NULL) param.changed();
+}
+
+void modbus_init(const void *input, uint8_t inputSize,
+                 const shell_param_t *holding, uint8_t holdingCount, uint32_t baud)
+{
+    uint32_t gap;
+
+    modbus_enable(0);
+    memset(&modbus.stats, 0, sizeof(modbus.stats));
+    modbus.input = input;
+    modbus.inputSize = inputSize;
+    modbus.holding = holding;
+    modbus.holdingCount = holdingCount;
+
+    // t3.5 of 11-bit characters in Timer0 ticks of 16 us, 64 us below 4800 Bd
+    gap = (baud > 19200) ? MODBUS_GAP_FAST : 38500000UL / baud;
+    TCCR0A = 0;
+    if (gap / 16 <= 255) {
+        TCCR0B = (1 << CS02);
+        OCR0A = gap / 16;
+    } else {
+        TCCR0B = (1 << CS02) | (1 << CS00);
+        OCR0A = (gap / 64 <= 255) ? gap / 64 : 255;
+    }
+}
+
+void modbus_enable(uint8_t address)
+{
+    TIMSK0 &= ~(1 << OCIE0A);
+    modbus.address = address;
+    modbus.received = 0;
+    modbus.frameSize = 0;
+    if (address != 0) {
+        // bytes received before are no request
+        while ((uart_getc() & UART_NO_DATA) == 0);
+    }
+}
+
+void modbus_rx_hook(void)
+{
+    if (modbus.address == 0) return;
+    TCNT0 = 0;
+    TIFR0 = (1 << OCF0A);
+    TIMSK0 |= (1 << OCIE0A);
+    if (modbus.received < 255) modbus.received++;
+}
+
+/**************************************************************************/
+/*!
+@brief  Timer0 compare match A, t3.5 of silence ends frame
+*/
+/**************************************************************************/
+
+ISR(TIMER0_COMPA_vect)
+{
+    uint16_t size = modbus.frameSize + modbus.received;
+
+    TIMSK0 &= ~(1 << OCIE0A);
+    // frame not read yet, both are read as one and fail CRC
+    modbus.frameSize = (size < 255) ? size : 255;
+    modbus.received = 0;
+}
+
+void modbus_poll(void)
+{
+    unsigned int received;
+    uint16_t crc = 0xFFFF;
+    uint16_t crcReceived = 0;
+    uint8_t error = 0;
+    uint8_t size;
+
+    cli();
+    size = modbus.frameSize;
+    modbus.frameSize = 0;
+    sei();
+    if (size == 0) return;
+
+    for (uint8_t i = 0; i < size; i++) {
+        received = uart_getc();
+        if (received & UART_NO_DATA) {
+            error = 1;      // lost by receive ring overflow
+            break;
+        }
+        if (received & 0xFF00) error = 1;
+        if (i < MODBUS_REQUEST_SIZE) modbus.frame[i] = received;
+        if (i + 2 < size) {
+            crc = _crc16_update(crc, received);
+        } else {
+            crcReceived = (crcReceived >> 8) | ((received & 0xFF) << 8);
+        }
+    }
+    if (error || size < 4 || crc != crcReceived) {
+        modbus.stats.errors++;
+        return;
+    }
+    if (modbus.frame[0] != modbus.address && modbus.frame[0] != 0) return;
+    modbus.stats.frames++;
+
+    switch (modbus.frame[1]) {
+    case 0x03:
+    case 0x04:
+        if (modbus.frame[0] == 0) return;   // reads are not broadcast
+        if (size != MODBUS_REQUEST_SIZE) {
+            modbus_exception(MODBUS_ILLEGAL_VALUE);
+        } else {
+            modbus_read();
+        }
+        break;
+    case 0x06:
+        if (size != MODBUS_REQUEST_SIZE) {
+            if (modbus.frame[0] != 0) modbus_exception(MODBUS_ILLEGAL_VALUE);
+        } else {
+            modbus_write(modbus.frame[0] == 0);
+        }
+        break;
+    default:
+        if (modbus.frame[0] != 0) modbus_exception(MODBUS_ILLEGAL_FUNCTION);
+        break;
+    }
+}
+
+const modbus_stats_t *modbus_stats(void)
+{
+    return &modbus.stats;
+}
@@ -0,0 +1,104 @@
+/**************************************************************************/
+/*!
+@file     modbus.h
+@brief    Header for Modbus RTU slave over UART
+*/
+/**************************************************************************/
+
+#ifndef MODBUS_H
+#define MODBUS_H
+
+#include <stdint.h>
+#include <shell.h>
+
+/// Most registers of one read request, keeps the reply (5 + 2n bytes) inside a 64-byte UART transmit ring
+#define MODBUS_MAX_QUANTITY 24
+
+/// Exception codes
+#define MODBUS_ILLEGAL_FUNCTION 0x01
+#define MODBUS_ILLEGAL_ADDRESS  0x02
+#define MODBUS_ILLEGAL_VALUE    0x03
+
+/**************************************************************************/
+/*!
+@brief  Counters of Modbus slave
+*/
+/**************************************************************************/
+
+typedef struct {
+    uint16_t frames;        /*!< Valid requests for this slave or broadcast */
+    uint16_t errors;        /*!< Frames with CRC or receive error */
+    uint16_t exceptions;    /*!< Exception replies */
+} modbus_stats_t;
+
+/**************************************************************************/
+/*!
+@brief  Initialize Modbus slave, stays disabled until modbus_enable()
+
+Input registers (function 04) are the bytes of a live structure, register
+n holds bytes 2n (low) and 2n+1 (high), so a 32-bit field spans two
+registers, low word first. Holding registers (functions 03 and 06) are
+the entries of a shell parameter table, float parameters are exchanged as
+rounded integers. A float beyond 0..65535, e.g. rzero of src/main.c, reads
+as 0 or 0xFFFF and can only be written within that range. Frame gaps are timed by Timer0 compare match A, the
+UART receive interrupt calls modbus_rx_hook(), see UART_RX_HOOK.
+
+@param[in] input         Structure of input registers
+@param[in] inputSize     Bytes of input structure
+@param[in] holding       Parameter table in flash
+@param[in] holdingCount  Number of parameters
+@param[in] baud          Baudrate of UART
+
+@return None
+*/
+/**************************************************************************/
+
+void modbus_init(const void *input, uint8_t inputSize,
+                 const shell_param_t *holding, uint8_t holdingCount, uint32_t baud);
+
+/**************************************************************************/
+/*!
+@brief  Set slave address and start or stop Timer0
+
+@param[in] address  Slave address (1–247), 0 disables the slave
+
+@return None
+*/
+/**************************************************************************/
+
+void modbus_enable(uint8_t address);
+
+/**************************************************************************/
+/*!
+@brief  Handle received request, never waits for input
+
+Call from main loop while the slave is enabled, the UART must not be
+read by anybody else.
+
+@return None
+*/
+/**************************************************************************/
+
+void modbus_poll(void);
+
+/**************************************************************************/
+/*!
+@brief  Restart frame gap timer, called by UART receive interrupt
+
+@return None
+*/
+/**************************************************************************/
+
+void modbus_rx_hook(void);
+
+/**************************************************************************/
+/*!
+@brief  Counters of Modbus slave
+
+@return Counters since modbus_init()
+*/
+/**************************************************************************/
+
+const modbus_stats_t *modbus_stats(void);
+
+#endif
@@ -10,7 +10,8 @@
 # include <avr/pgmspace.h>
 
 // extern const char ssd1306oled_font[][6] PROGMEM;
-// extern const char special_char[][2] PROGMEM;
+// extern const uint8_t unicode_index[] PROGMEM;
+// extern const uint16_t unicode_range[][3] PROGMEM;
 
 const char ssd1306oled_font[][6] PROGMEM = {
     {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // sp
@@ -109,9 +110,9 @@ const char ssd1306oled_font[][6] PROGMEM = {
     {0x00, 0x00, 0x41, 0x77, 0x08, 0x00}, // }
     {0x00, 0x08, 0x04, 0x08, 0x08, 0x04}, // ~
     /* end of normal char-set */
-    /* put your own signs/chars here, edit special_char too */
+    /* put your own signs/chars here, edit unicode_index too */
     /* be sure that your first special char stand here */
-    {0x00, 0x3A, 0x40, 0x40, 0x20, 0x7A}, // ü, !!! Important: this must be special_char[0] !!!
+    {0x00, 0x3A, 0x40, 0x40, 0x20, 0x7A}, // ü
     {0x00, 0x3D, 0x40, 0x40, 0x40, 0x3D}, // Ü
     {0x00, 0x21, 0x54, 0x54, 0x54, 0x79}, // ä
     {0x00, 0x7D, 0x12, 0x11, 0x12, 0x7D}, // Ä
@@ -124,24 +125,51 @@ const char ssd1306oled_font[][6] PROGMEM = {
     {0x00, 0x5C, 0x62, 0x02, 0x62, 0x5C} // Ω
 };
 
-const char special_char[][2] PROGMEM = {
-    // define position of special char in font
-    // {special char, position in font}
-    // be sure that last element of this
-    // array are {0xff, 0xff} and first element
-    // are {first special char, first element after normal char-set in font}
-    {'ü', 95},  // special_char[0]
-    {'Ü', 96},
-    {'ä', 97},
-    {'Ä', 98},
-    {'ö', 99},
-    {'Ö', 100},
-    {'°', 101},
-    {'ß', 102},
-    {'µ', 103},
-    {'ω', 104},
-    {'Ω', 105},
-    {0xff, 0xff} // end of table special_char
+// glyph position in font for every unicode code point beyond ascii,
+// 0xff = no glyph. Czech letters without own glyph are shown by their base letter.
+// be sure to edit unicode_index and unicode_range if you add glyphs to font
+const uint8_t unicode_index[] PROGMEM = {
+    // U+00A0 ... U+017F, Latin-1 Supplement and Latin Extended-A
+    0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, // U+00A0 nbsp
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, // U+00A8
+    0x65, 0xFF, 0xFF, 0xFF, 0xFF, 0x67, 0xFF, 0xFF, // U+00B0 ° µ
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, // U+00B8
+    0xFF, 0x21, 0xFF, 0xFF, 0x62, 0xFF, 0xFF, 0xFF, // U+00C0 Á Ä
+    0xFF, 0x25, 0xFF, 0xFF, 0xFF, 0x29, 0xFF, 0xFF, // U+00C8 É Í
+    0xFF, 0xFF, 0xFF, 0x2F, 0xFF, 0xFF, 0x64, 0xFF, // U+00D0 Ó Ö
+    0xFF, 0xFF, 0x35, 0xFF, 0x60, 0x39, 0xFF, 0x66, // U+00D8 Ú Ü Ý ß
+    0xFF, 0x41, 0xFF, 0xFF, 0x61, 0xFF, 0xFF, 0xFF, // U+00E0 á ä
+    0xFF, 0x45, 0xFF, 0xFF, 0xFF, 0x49, 0xFF, 0xFF, // U+00E8 é í
+    0xFF, 0xFF, 0xFF, 0x4F, 0xFF, 0xFF, 0x63, 0xFF, // U+00F0 ó ö
+    0xFF, 0xFF, 0x55, 0xFF, 0x5F, 0x59, 0xFF, 0xFF, // U+00F8 ú ü ý
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, // U+0100
+    0xFF, 0xFF, 0xFF, 0xFF, 0x23, 0x43, 0x24, 0x44, // U+0108 Č č Ď ď
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, // U+0110
+    0xFF, 0xFF, 0x25, 0x45, 0xFF, 0xFF, 0xFF, 0xFF, // U+0118 Ě ě
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, // U+0120
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, // U+0128
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, // U+0130
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, // U+0138
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x2E, // U+0140 Ň
+    0x4E, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, // U+0148 ň
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, // U+0150
+    0x32, 0x52, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, // U+0158 Ř ř
+    0x33, 0x53, 0xFF, 0xFF, 0x34, 0x54, 0xFF, 0xFF, // U+0160 Š š Ť ť
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x35, 0x55, // U+0168 Ů ů
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, // U+0170
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x3A, 0x5A, 0xFF, // U+0178 Ž ž
+    // U+03A9 ... U+03C9, Greek
+    0x69, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, // U+03A9 Ω
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, // U+03B1
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, // U+03B9
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, // U+03C1
+    0x68                                            // U+03C9 ω
+};
+
+const uint16_t unicode_range[][3] PROGMEM = {
+    // {first code point, last code point, offset in unicode_index}
+    {0x00A0, 0x017F, 0},
+    {0x03A9, 0x03C9, 0x017F - 0x00A0 + 1},
 };
 
 #endif
@@ -42,6 +42,9 @@
  *
  *  at TEXTMODE lib need static SRAM for display:
  *  2 bytes (cursorPosition)
+ *
+ *  at PAGEMODE lib needs static SRAM for one display page:
+ *  DISPLAY-WIDTH + 3 bytes
  */
 
 #include "oled.h"
@@ -50,6 +53,7 @@
 
 #if defined SPI
 # include <util/delay.h>
+# include <avr/interrupt.h>
 #endif
 
 static struct {
@@ -57,10 +61,31 @@ static struct {
     uint8_t y;
 } cursorPosition;
 
+static struct {
+    uint16_t codePoint;
+    uint8_t pending;     // continuation bytes still expected
+} utf8;
+
 static uint8_t charMode = NORMALSIZE;
+static uint8_t startLine;   // display RAM row shown at top of display
 #if defined GRAPHICMODE
 # include <stdlib.h>
 static uint8_t displayBuffer[DISPLAY_HEIGHT/8][DISPLAY_WIDTH];
+# define BUFFER_LINE(line)      displayBuffer[line]
+# define LINE_IN_BUFFER(line)   (1)
+// column range of each line waiting for oled_display_dirty(), end == 0: clean
+static struct {
+    uint8_t first;
+    uint8_t end;
+} dirtyBlock[DISPLAY_HEIGHT/8];
+#elif defined PAGEMODE
+# include <stdlib.h>
+// only the page currently rendered by oled_render() is held in SRAM,
+// drawing outside oled_render() has no effect
+static uint8_t displayBuffer[DISPLAY_WIDTH];
+static uint8_t renderPage = DISPLAY_HEIGHT/8;
+# define BUFFER_LINE(line)      displayBuffer
+# define LINE_IN_BUFFER(line)   ((line) == renderPage)
 #elif defined TEXTMODE
 #else
 # error "No valid displaymode! Refer oled.h"
@@ -97,7 +122,119 @@ const uint8_t init_sequence [] PROGMEM = {    // Initialization Sequence
     0x20,            // 0x20,0.77xVcc
     0x8D, 0x14,      // Set DC-DC enable
 };
+const uint8_t doubleNibble [] PROGMEM = {     // DOUBLESIZE bit-doubling
+    // every bit of the nibble index is doubled, e.g. 0b0101 -> 0b00110011
+    0x00, 0x03, 0x0C, 0x0F, 0x30, 0x33, 0x3C, 0x3F,
+    0xC0, 0xC3, 0xCC, 0xCF, 0xF0, 0xF3, 0xFC, 0xFF
+};
 // #pragma mark LCD COMMUNICATION
+#if defined SPI
+// transfers are queued and sent byte by byte by SPI_STC_vect,
+// commands are copied into the queue, data is sent from its buffer:
+// only data of displayBuffer is queued, other data and long commands
+// are sent at once after the queue is empty
+# define SPI_QUEUE_MASK (OLED_SPI_QUEUE_SIZE-1)
+# if (OLED_SPI_QUEUE_SIZE & SPI_QUEUE_MASK)
+#  error "OLED_SPI_QUEUE_SIZE is not a power of 2"
+# endif
+# define SPI_CMD_SIZE 4     // longest queued command (set address)
+static struct {
+    const uint8_t *data;    // NULL: command in cmd[]
+    uint16_t size;
+    uint8_t cmd[SPI_CMD_SIZE];
+} spiQueue[OLED_SPI_QUEUE_SIZE];
+static volatile uint8_t spiHead;    // next free entry
+static volatile uint8_t spiTail;    // entry actually sent, queue empty if spiHead == spiTail
+static const uint8_t *spiData;      // next byte of actual transfer
+static uint16_t spiSize;            // bytes of actual transfer not yet sent completely
+
+static void oled_spi_start(void){
+    // start transfer at queue tail, CS stays low until queue is empty
+    if (spiQueue[spiTail].data) {
+        OLED_PORT |= (1 << DC_PIN);
+        spiData = spiQueue[spiTail].data;
+    } else {
+        OLED_PORT &= ~(1 << DC_PIN);
+        spiData = spiQueue[spiTail].cmd;
+    }
+    spiSize = spiQueue[spiTail].size;
+    OLED_PORT &= ~(1 << CS_PIN);
+    SPDR = *spiData++;
+}
+static void oled_spi_next(void){
+    // byte sent: next byte, next queued transfer or end
+    if (--spiSize) {
+        SPDR = *spiData++;
+        return;
+    }
+    spiTail = (spiTail + 1) & SPI_QUEUE_MASK;
+    if (spiTail != spiHead) {
+        oled_spi_start();
+    } else {
+        OLED_PORT |= (1 << CS_PIN);
+    }
+}
+ISR(SPI_STC_vect){
+    oled_spi_next();
+}
+static void oled_spi_flush(void){
+    // wait until queue is empty, with global interrupts off (ISR, cli())
+    // SPI_STC_vect cannot run, so its work is polled here
+    if (SREG & _BV(SREG_I)) {
+        while (spiHead != spiTail);
+        return;
+    }
+    while (spiHead != spiTail) {
+        while (!(SPSR & (1<<SPIF)));
+        oled_spi_next();
+    }
+    (void)SPDR;    // clear SPIF of last byte, no interrupt after sei()
+}
+static void oled_spi_send(const uint8_t data[], uint16_t size, uint8_t isData);
+static void oled_spi_queue(const uint8_t data[], const uint8_t cmd[], uint16_t size){
+    uint8_t head = spiHead;
+    uint8_t next = (head + 1) & SPI_QUEUE_MASK;
+    
+    if (size == 0) return;
+    if (!(SREG & _BV(SREG_I))) {
+        // nothing would drain the queue, send at once
+        oled_spi_send(data ? data : cmd, size, data != NULL);
+        return;
+    }
+    while (next == spiTail);    // wait for free entry
+    spiQueue[head].data = data;
+    spiQueue[head].size = size;
+    if (data == NULL) memcpy(spiQueue[head].cmd, cmd, size);
+    
+    uint8_t sreg = SREG;
+    cli();
+    uint8_t idle = (spiHead == spiTail);
+    spiHead = next;
+    if (idle) oled_spi_start();
+    SREG = sreg;
+}
+static void oled_spi_send(const uint8_t data[], uint16_t size, uint8_t isData){
+    // send at once, in order after all queued transfers
+    oled_spi_flush();
+    SPCR &= ~(1 << SPIE);
+	OLED_PORT &= ~(1 << CS_PIN);
+    if (isData) {
+        OLED_PORT |= (1 << DC_PIN);
+    } else {
+        OLED_PORT &= ~(1 << DC_PIN);
+    }
+	for (uint16_t i = 0; i<size; i++) {
+        SPDR = data[i];
+        while(!(SPSR & (1<<SPIF)));
+    }
+    (void)SPDR;    // clear SPIF, no interrupt for last byte
+    OLED_PORT |= (1 << CS_PIN);
+    SPCR |= (1 << SPIE);
+}
+uint8_t oled_busy(void){
+    return (spiHead != spiTail);
+}
+#endif
 void oled_command(uint8_t cmd[], uint8_t size) {
 #if defined I2C
     twi_start();
@@ -111,13 +248,11 @@ void oled_command(uint8_t cmd[], uint8_t size) {
     }
     twi_stop();
 #elif defined SPI
-	OLED_PORT &= ~(1 << CS_PIN);
-	OLED_PORT &= ~(1 << DC_PIN);
-	for (uint8_t i=0; i<size; i++) {
-        SPDR = cmd[i];
-        while(!(SPSR & (1<<SPIF)));
+    if (size <= SPI_CMD_SIZE) {
+        oled_spi_queue(NULL, cmd, size);
+    } else {
+        oled_spi_send(cmd, size, 0);
     }
-    OLED_PORT |= (1 << CS_PIN);
 #endif
 }
 void oled_data(uint8_t data[], uint16_t size) {
@@ -134,13 +269,58 @@ void oled_data(uint8_t data[], uint16_t size) {
     twi_stop();
     // i2c_stop();
 #elif defined SPI
-	OLED_PORT &= ~(1 << CS_PIN);
-	OLED_PORT |= (1 << DC_PIN);
-	for (uint16_t i = 0; i<size; i++) {
-        SPDR = data[i];
-        while(!(SPSR & (1<<SPIF)));
+# if defined GRAPHICMODE
+    if (data >= &displayBuffer[0][0] && data + size <= &displayBuffer[0][0] + sizeof(displayBuffer)) {
+        // buffer keeps its content, send in background
+        oled_spi_queue(data, NULL, size);
+        return;
     }
-    OLED_PORT |= (1 << CS_PIN);
+# endif
+    oled_spi_send(data, size, 1);
+#endif
+}
+static uint8_t oled_address_sequence(uint8_t x, uint8_t line, uint8_t cmd[]){
+#if defined (SSD1306) || defined (SSD1309)
+    cmd[0] = 0xb0+line;
+    cmd[1] = 0x21;      // column range x...127
+    cmd[2] = x;
+    cmd[3] = 0x7f;
+    return 4;
+#elif defined SH1106
+    // page addressing only, panel starts at column 2 of 132
+    // (0x40...0x7F would set the display start line)
+    cmd[0] = 0xb0+line;
+    cmd[1] = 0x00+((2+x) & (0x0f));
+    cmd[2] = 0x10+(((2+x) & (0xf0)) >> 4);
+    return 3;
+#endif
+}
+#if defined TEXTMODE || defined SPI
+static void oled_set_address(uint8_t x, uint8_t line){
+    uint8_t commandSequence[4];
+    oled_command(commandSequence, oled_address_sequence(x, line, commandSequence));
+}
+#endif
+static void oled_data_at(uint8_t x, uint8_t line, uint8_t data[], uint16_t size){
+#if defined I2C
+    // address commands and data in one transaction: control byte
+    // with Co bit before each command, then data to the end
+    uint8_t commandSequence[4];
+    uint8_t commands = oled_address_sequence(x, line, commandSequence);
+    twi_start();
+    twi_write((OLED_I2C_ADR<<1) | TWI_WRITE);
+    for (uint8_t i = 0; i < commands; i++) {
+        twi_write(0x80);
+        twi_write(commandSequence[i]);
+    }
+    twi_write(0x40);
+    for (uint16_t i = 0; i<size; i++) {
+        twi_write(data[i]);
+    }
+    twi_stop();
+#elif defined SPI
+    oled_set_address(x, line);
+    oled_data(data, size);
 #endif
 }
 // #pragma mark -
@@ -151,7 +331,8 @@ void oled_init(uint8_t dispAttr){
     twi_init();
 #elif defined SPI
 	DDRB |= (1 << PB2)|(1 << PB3)|(1 << PB5);
-    SPCR = (1 << SPE)|(1<<MSTR)|(1<<SPR0);
+    SPCR = (1 << SPE)|(1<<MSTR);  // SPI clock F_CPU/2 with SPI2X, SPIE after init sequence
+    SPSR = (1 << SPI2X);
     OLED_DDR |= (1 << CS_PIN)|(1 << DC_PIN)|(1 << RES_PIN);
     OLED_PORT |= (1 << CS_PIN)|(1 << DC_PIN)|(1 << RES_PIN);
     OLED_PORT &= ~(1 << RES_PIN);
@@ -159,13 +340,35 @@ void oled_init(uint8_t dispAttr){
     OLED_PORT |= (1 << RES_PIN);
 #endif
 
-    uint8_t commandSequence[sizeof(init_sequence)+1];
+    // stream init sequence from flash, display stays off until its RAM is written
+#if defined I2C
+    twi_start();
+    twi_write((OLED_I2C_ADR<<1) | TWI_WRITE);
+    twi_write(0x00);
     for (uint8_t i = 0; i < sizeof (init_sequence); i++) {
-        commandSequence[i] = (pgm_read_byte(&init_sequence[i]));
+        twi_write(pgm_read_byte(&init_sequence[i]));
     }
-    commandSequence[sizeof(init_sequence)]=(dispAttr);
-    oled_command(commandSequence, sizeof(commandSequence));
+    twi_stop();
+#elif defined SPI
+    OLED_PORT &= ~((1 << CS_PIN)|(1 << DC_PIN));
+    for (uint8_t i = 0; i < sizeof (init_sequence); i++) {
+        SPDR = pgm_read_byte(&init_sequence[i]);
+        while(!(SPSR & (1<<SPIF)));
+    }
+    (void)SPDR;    // clear SPIF, no interrupt for last byte
+    OLED_PORT |= (1 << CS_PIN);
+    SPCR |= (1 << SPIE);
+#endif
+#if defined GRAPHICMODE
+    // buffer replaces clearing: zero after reset or first frame (splash)
+    // drawn before oled_init(), shown together when display turns on
+    oled_display();
+    oled_home();
+#else
     oled_clrscr();
+#endif
+    uint8_t commandSequence[1] = {dispAttr};
+    oled_command(commandSequence, 1);
 }
 void oled_gotoxy(uint8_t x, uint8_t y){
     x = x * sizeof(FONT[0]);
@@ -175,26 +378,25 @@ void oled_goto_xpix_y(uint8_t x, uint8_t y){
     if( x > (DISPLAY_WIDTH) || y > (DISPLAY_HEIGHT/8-1)) return;// out of display
     cursorPosition.x=x;
     cursorPosition.y=y;
-#if defined (SSD1306) || defined (SSD1309)
-    uint8_t commandSequence[] = {0xb0+y, 0x21, x, 0x7f};
-#elif defined SH1106
-    uint8_t commandSequence[] = {0xb0+y, 0x21, 0x00+((2+x) & (0x0f)), 0x10+( ((2+x) & (0xf0)) >> 4 ), 0x7f};
+#if defined TEXTMODE
+    // buffered modes set the address when the buffer is sent
+    oled_set_address(x, y);
 #endif
-    oled_command(commandSequence, sizeof(commandSequence));
 }
 void oled_clrscr(void){
 #ifdef GRAPHICMODE
+    memset(displayBuffer, 0x00, sizeof(displayBuffer));
+    oled_display();
+#elif defined PAGEMODE
+    memset(displayBuffer, 0x00, sizeof(displayBuffer));
     for (uint8_t i = 0; i < DISPLAY_HEIGHT/8; i++){
-        memset(displayBuffer[i], 0x00, sizeof(displayBuffer[i]));
-        oled_gotoxy(0,i);
-        oled_data(displayBuffer[i], sizeof(displayBuffer[i]));
+        oled_data_at(0, i, displayBuffer, sizeof(displayBuffer));
     }
 #elif defined TEXTMODE
     uint8_t displayBuffer[DISPLAY_WIDTH];
     memset(displayBuffer, 0x00, sizeof(displayBuffer));
     for (uint8_t i = 0; i < DISPLAY_HEIGHT/8; i++){
-        oled_gotoxy(0,i);
-        oled_data(displayBuffer, sizeof(displayBuffer));
+        oled_data_at(0, i, displayBuffer, sizeof(displayBuffer));
     }
 #endif
     oled_home();
@@ -224,7 +426,82 @@ void oled_set_contrast(uint8_t contrast){
     uint8_t commandSequence[2] = {0x81, contrast};
     oled_command(commandSequence, sizeof(commandSequence));
 }
+void oled_set_start_line(uint8_t row){
+    startLine = row & (DISPLAY_HEIGHT-1);
+    uint8_t commandSequence[1] = {0x40 | startLine};
+    oled_command(commandSequence, 1);
+}
+uint8_t oled_scroll_line(void){
+    // display RAM is used as ring of lines: the top line moves one line down
+    // the ring and the line which was on top reappears as bottom line
+    uint8_t line = startLine / 8;
+    oled_set_start_line(startLine + 8);
+#if defined GRAPHICMODE || defined PAGEMODE
+    if (LINE_IN_BUFFER(line)) {
+        memset(BUFFER_LINE(line), 0x00, DISPLAY_WIDTH);
+    }
+    cursorPosition.x = 0;
+    cursorPosition.y = line;
+#elif defined TEXTMODE
+    oled_gotoxy(0, line);
+#endif
+    return line;
+}
+#if defined (SSD1306) || defined (SSD1309)
+void oled_scroll_continuous(uint8_t direction, uint8_t startPage, uint8_t endPage, uint8_t interval, uint8_t verticalOffset){
+    // scroll setup is only accepted while scrolling is deactivated
+    uint8_t commandSequence[] = {0x2E, direction, 0x00, startPage, interval, endPage, 0x00, 0xFF, 0x2F};
+    if (direction == OLED_SCROLL_VERTICAL_RIGHT || direction == OLED_SCROLL_VERTICAL_LEFT) {
+        // vertical and horizontal scroll has vertical offset instead of the column range,
+        // vertical scroll area is whole display
+        uint8_t verticalSequence[] = {0x2E, 0xA3, 0x00, DISPLAY_HEIGHT,
+            direction, 0x00, startPage, interval, endPage, verticalOffset & (DISPLAY_HEIGHT-1), 0x2F};
+        oled_command(verticalSequence, sizeof(verticalSequence));
+        return;
+    }
+    oled_command(commandSequence, sizeof(commandSequence));
+}
+void oled_scroll_stop(void){
+    uint8_t commandSequence[1] = {0x2E};
+    oled_command(commandSequence, 1);
+}
+#endif
+static uint8_t oled_glyph_index(uint16_t codePoint){
+    // code point to glyph position in font, ranges of unicode_index are few
+    for (uint8_t i = 0; i < sizeof(unicode_range)/sizeof(unicode_range[0]); i++) {
+        uint16_t first = pgm_read_word(&unicode_range[i][0]);
+        if (codePoint >= first && codePoint <= pgm_read_word(&unicode_range[i][1])) {
+            return pgm_read_byte(&unicode_index[pgm_read_word(&unicode_range[i][2]) + codePoint - first]);
+        }
+    }
+    return 0xff;
+}
+static uint8_t oled_utf8_glyph(uint8_t byte){
+    // collect utf-8 sequence, returns glyph position at its last byte,
+    // 0xff while sequence is incomplete or for chars not in font
+    if ((byte & 0xC0) == 0x80) {
+        if (utf8.pending == 0) return 0xff;   // continuation without lead byte
+        // code points beyond 16 bit are not in font
+        utf8.codePoint = (utf8.codePoint < 0x0400) ? (utf8.codePoint << 6) | (byte & 0x3F) : 0xffff;
+        if (--utf8.pending) return 0xff;
+        return oled_glyph_index(utf8.codePoint);
+    }
+    if ((byte & 0xE0) == 0xC0) {
+        utf8.codePoint = byte & 0x1F;
+        utf8.pending = 1;
+    } else if ((byte & 0xF0) == 0xE0) {
+        utf8.codePoint = byte & 0x0F;
+        utf8.pending = 2;
+    } else if ((byte & 0xF8) == 0xF0) {
+        utf8.codePoint = byte & 0x07;
+        utf8.pending = 3;
+    } else {
+        utf8.pending = 0;
+    }
+    return 0xff;
+}
 void oled_putc(char c){
+    if (!((uint8_t)c & 0x80)) utf8.pending = 0;  // ascii breaks any utf-8 sequence
     switch (c) {
         case '\b':
             // backspace
@@ -251,112 +528,83 @@ void oled_putc(char c){
             oled_gotoxy(0, cursorPosition.y);
             break;
         default:
-            // char doesn't fit in line
-            if( (cursorPosition.x >= DISPLAY_WIDTH-sizeof(FONT[0])) || (c < ' ') ) break;
             // mapping char
-            c -= ' ';
-            if (c >= pgm_read_byte(&special_char[0][1]) ) {
-                char temp = c;
-                c = 0xff;
-                for (uint8_t i=0; pgm_read_byte(&special_char[i][1]) != 0xff; i++) {
-                    if ( pgm_read_byte(&special_char[i][0])-' ' == temp ) {
-                        c = pgm_read_byte(&special_char[i][1]);
-                        break;
-                    }
-                }
-                if ( c == 0xff ) break;
+            if ((uint8_t)c & 0x80) {
+                c = oled_utf8_glyph(c);
+                if ( (uint8_t)c == 0xff ) break;
+            } else {
+                if ( (c < ' ') || (c > '~') ) break;
+                c -= ' ';
             }
+            // char doesn't fit in line
+            if( cursorPosition.x >= DISPLAY_WIDTH-sizeof(FONT[0]) ) break;
             // print char at display
-#ifdef GRAPHICMODE
+#if defined GRAPHICMODE || defined PAGEMODE
             if (charMode == DOUBLESIZE) {
-                uint16_t doubleChar[sizeof(FONT[0])];
-                uint8_t dChar;
+                uint8_t dChar, dByte;
                 if ((cursorPosition.x+2*sizeof(FONT[0]))>DISPLAY_WIDTH) break;
-                
-                for (uint8_t i=0; i < sizeof(FONT[0]); i++) {
-                    doubleChar[i] = 0;
-                    dChar = pgm_read_byte(&(FONT[(uint8_t)c][i]));
-                    for (uint8_t j=0; j<8; j++) {
-                        if ((dChar & (1 << j))) {
-                            doubleChar[i] |= (1 << (j*2));
-                            doubleChar[i] |= (1 << ((j*2)+1));
-                        }
-                    }
+                if (!LINE_IN_BUFFER(cursorPosition.y) && !LINE_IN_BUFFER(cursorPosition.y+1)) {
+                    // char is not on the page actually rendered
+                    cursorPosition.x += sizeof(FONT[0])*2;
+                    break;
                 }
+                
                 for (uint8_t i = 0; i < sizeof(FONT[0]); i++)
                 {
-                    // load bit-pattern from flash
-                    displayBuffer[cursorPosition.y+1][cursorPosition.x+(2*i)] = doubleChar[i] >> 8;
-                    displayBuffer[cursorPosition.y+1][cursorPosition.x+(2*i)+1] = doubleChar[i] >> 8;
-                    displayBuffer[cursorPosition.y][cursorPosition.x+(2*i)] = doubleChar[i] & 0xff;
-                    displayBuffer[cursorPosition.y][cursorPosition.x+(2*i)+1] = doubleChar[i] & 0xff;
+                    // load bit-pattern from flash, double it by nibble lookup
+                    dChar = pgm_read_byte(&(FONT[(uint8_t)c][i]));
+                    if (LINE_IN_BUFFER(cursorPosition.y+1)) {
+                        dByte = pgm_read_byte(&doubleNibble[dChar >> 4]);
+                        BUFFER_LINE(cursorPosition.y+1)[cursorPosition.x+(2*i)] = dByte;
+                        BUFFER_LINE(cursorPosition.y+1)[cursorPosition.x+(2*i)+1] = dByte;
+                    }
+                    if (LINE_IN_BUFFER(cursorPosition.y)) {
+                        dByte = pgm_read_byte(&doubleNibble[dChar & 0x0f]);
+                        BUFFER_LINE(cursorPosition.y)[cursorPosition.x+(2*i)] = dByte;
+                        BUFFER_LINE(cursorPosition.y)[cursorPosition.x+(2*i)+1] = dByte;
+                    }
                 }
                 cursorPosition.x += sizeof(FONT[0])*2;
             } else {
             	if ((cursorPosition.x+sizeof(FONT[0]))>DISPLAY_WIDTH) break;
             	
-                for (uint8_t i = 0; i < sizeof(FONT[0]); i++)
+                for (uint8_t i = 0; LINE_IN_BUFFER(cursorPosition.y) && i < sizeof(FONT[0]); i++)
                 {
                     // load bit-pattern from flash
-                    displayBuffer[cursorPosition.y][cursorPosition.x+i] =pgm_read_byte(&(FONT[(uint8_t)c][i]));
+                    BUFFER_LINE(cursorPosition.y)[cursorPosition.x+i] =pgm_read_byte(&(FONT[(uint8_t)c][i]));
                 }
                 cursorPosition.x += sizeof(FONT[0]);
             }
 #elif defined TEXTMODE
             if (charMode == DOUBLESIZE) {
-                uint16_t doubleChar[sizeof(FONT[0])];
                 uint8_t dChar;
                 if ((cursorPosition.x+2*sizeof(FONT[0]))>DISPLAY_WIDTH) break;
                 
-                for (uint8_t i=0; i < sizeof(FONT[0]); i++) {
-                    doubleChar[i] = 0;
-                    dChar = pgm_read_byte(&(FONT[(uint8_t)c][i]));
-                    for (uint8_t j=0; j<8; j++) {
-                        if ((dChar & (1 << j))) {
-                            doubleChar[i] |= (1 << (j*2));
-                            doubleChar[i] |= (1 << ((j*2)+1));
-                        }
-                    }
-                }
                 uint8_t data[sizeof(FONT[0])*2];
                 for (uint8_t i = 0; i < sizeof(FONT[0]); i++)
                 {
                     // print font to ram, print 6 columns
-                    data[i<<1]=(doubleChar[i] & 0xff);
-                    data[(i<<1)+1]=(doubleChar[i] & 0xff);
+                    dChar = pgm_read_byte(&(FONT[(uint8_t)c][i]));
+                    data[i<<1]=pgm_read_byte(&doubleNibble[dChar & 0x0f]);
+                    data[(i<<1)+1]=data[i<<1];
                 }
                 oled_data(data, sizeof(FONT[0])*2);
                 
-#if defined (SSD1306) || defined (SSD1309)
-                uint8_t commandSequence[] = {0xb0+cursorPosition.y+1,
-                    0x21,
-                    cursorPosition.x,
-                    0x7f};
-#elif defined SH1106
-                uint8_t commandSequence[] = {0xb0+cursorPosition.y+1,
-                    0x21,
-                    0x00+((2+cursorPosition.x) & (0x0f)),
-                    0x10+( ((2+cursorPosition.x) & (0xf0)) >> 4 ),
-                    0x7f};
-#endif
-                oled_command(commandSequence, sizeof(commandSequence));
+                // lower half one page below, same address commands as every page write
+                uint8_t commandSequence[4];
+                oled_command(commandSequence, oled_address_sequence(cursorPosition.x, cursorPosition.y+1, commandSequence));
                 
                 for (uint8_t i = 0; i < sizeof(FONT[0]); i++)
                 {
                     // print font to ram, print 6 columns
-                    data[i<<1]=(doubleChar[i] >> 8);
-                    data[(i<<1)+1]=(doubleChar[i] >> 8);
+                    dChar = pgm_read_byte(&(FONT[(uint8_t)c][i]));
+                    data[i<<1]=pgm_read_byte(&doubleNibble[dChar >> 4]);
+                    data[(i<<1)+1]=data[i<<1];
                 }
                 oled_data(data, sizeof(FONT[0])*2);
                 
-                commandSequence[0] = 0xb0+cursorPosition.y;
-#if defined (SSD1306) || defined (SSD1309)
-                commandSequence[2] = cursorPosition.x+(2*sizeof(FONT[0]));
-#elif defined SH1106
-                commandSequence[2] = 0x00+((2+cursorPosition.x+(2*sizeof(FONT[0]))) & (0x0f));
-                commandSequence[3] = 0x10+( ((2+cursorPosition.x+(2*sizeof(FONT[0]))) & (0xf0)) >> 4 );
-#endif
-                oled_command(commandSequence, sizeof(commandSequence));
+                // back to upper line behind the glyph
+                oled_command(commandSequence, oled_address_sequence(cursorPosition.x+(2*sizeof(FONT[0])), cursorPosition.y, commandSequence));
                 cursorPosition.x += sizeof(FONT[0])*2;
             } else {
                 uint8_t data[sizeof(FONT[0])];
@@ -418,16 +666,47 @@ void oled_puts_p(const char* progmem_s){
         oled_putc(c);
     }
 }
-#ifdef GRAPHICMODE
+#if defined GRAPHICMODE || defined PAGEMODE
 // #pragma mark -
 // #pragma mark GRAPHIC FUNCTIONS
+static uint8_t oled_fillArea(int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint8_t color){
+    // fill x1..x2, y1..y2 (x1<=x2, y1<=y2) by whole bytes of each page,
+    // returns 1 if area was clipped at display
+    uint8_t result = 0;
+    
+    if( x2 < 0 || y2 < 0 || x1 > DISPLAY_WIDTH-1 || y1 > DISPLAY_HEIGHT-1) return 1; // out of Display
+    if( x1 < 0) { x1 = 0; result = 1; }
+    if( y1 < 0) { y1 = 0; result = 1; }
+    if( x2 > DISPLAY_WIDTH-1) { x2 = DISPLAY_WIDTH-1; result = 1; }
+    if( y2 > DISPLAY_HEIGHT-1) { y2 = DISPLAY_HEIGHT-1; result = 1; }
+    
+    uint8_t lastPage = y2 >> 3;
+    uint8_t mask = 0xff << (y1 & 7);
+    for (uint8_t page = y1 >> 3; page <= lastPage; page++){
+        if( page == lastPage) mask &= 0xff >> (7 - (y2 & 7));
+        if( LINE_IN_BUFFER(page)){
+            uint8_t *column = &BUFFER_LINE(page)[x1];
+            uint8_t width = x2 - x1 + 1;
+            if( color == WHITE){
+                while (width--) *column++ |= mask;
+            } else {
+                mask = ~mask;
+                while (width--) *column++ &= mask;
+            }
+        }
+        mask = 0xff;
+    }
+    
+    return result;
+}
 uint8_t oled_drawPixel(uint8_t x, uint8_t y, uint8_t color){
     if( x > DISPLAY_WIDTH-1 || y > (DISPLAY_HEIGHT-1)) return 1; // out of Display
+    if( !LINE_IN_BUFFER(y / 8)) return 0; // not on the page actually rendered
     
     if( color == WHITE){
-        displayBuffer[(y / 8)][x] |= (1 << (y % 8));
+        BUFFER_LINE(y / 8)[x] |= (1 << (y % 8));
     } else {
-        displayBuffer[(y / 8)][x] &= ~(1 << (y % 8));
+        BUFFER_LINE(y / 8)[x] &= ~(1 << (y % 8));
     }
     
     return 0;
@@ -435,6 +714,11 @@ uint8_t oled_drawPixel(uint8_t x, uint8_t y, uint8_t color){
 uint8_t oled_drawLine(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2, uint8_t color){
 	uint8_t result;
 	
+    if( x1 == x2 || y1 == y2){
+        // horizontal or vertical line is a span of whole bytes
+        return oled_fillArea(x1 < x2 ? x1 : x2, y1 < y2 ? y1 : y2,
+                             x1 < x2 ? x2 : x1, y1 < y2 ? y2 : y1, color);
+    }
     int dx =  abs(x2-x1), sx = x1<x2 ? 1 : -1;
     int dy = -abs(y2-y1), sy = y1<y2 ? 1 : -1;
     int err = dx+dy, e2; /* error value e_xy */
@@ -460,21 +744,18 @@ uint8_t oled_drawRect(uint8_t px1, uint8_t py1, uint8_t px2, uint8_t py2, uint8_
     return result;
 }
 uint8_t oled_fillRect(uint8_t px1, uint8_t py1, uint8_t px2, uint8_t py2, uint8_t color){
-    uint8_t result;
-    
     if( px1 > px2){
         uint8_t temp = px1;
         px1 = px2;
         px2 = temp;
-        temp = py1;
+    }
+    if( py1 > py2){
+        uint8_t temp = py1;
         py1 = py2;
         py2 = temp;
     }
-    for (uint8_t i=0; i<=(py2-py1); i++){
-        result = oled_drawLine(px1, py1+i, px2, py1+i, color);
-    }
     
-    return result;
+    return oled_fillArea(px1, py1, px2, py2, color);
 }
 uint8_t oled_drawCircle(uint8_t center_x, uint8_t center_y, uint8_t radius, uint8_t color){
     uint8_t result;
@@ -513,50 +794,193 @@ uint8_t oled_drawCircle(uint8_t center_x, uint8_t center_y, uint8_t radius, uint
 }
 uint8_t oled_fillCircle(uint8_t center_x, uint8_t center_y, uint8_t radius, uint8_t color) {
     uint8_t result;
-    for(uint8_t i=0; i<= radius;i++){
-        result = oled_drawCircle(center_x, center_y, i, color);
+    
+    int16_t f = 1 - radius;
+    int16_t ddF_x = 1;
+    int16_t ddF_y = -2 * radius;
+    int16_t x = 0;
+    int16_t y = radius;
+    
+    // fill symmetric column spans, columns are whole bytes in display pages
+    result = oled_fillArea(center_x, center_y-radius, center_x, center_y+radius, color);
+    
+    while (x<y) {
+        if (f >= 0) {
+            y--;
+            ddF_y += 2;
+            f += ddF_y;
+        }
+        x++;
+        ddF_x += 2;
+        f += ddF_x;
+        
+        result |= oled_fillArea(center_x + x, center_y - y, center_x + x, center_y + y, color);
+        result |= oled_fillArea(center_x - x, center_y - y, center_x - x, center_y + y, color);
+        result |= oled_fillArea(center_x + y, center_y - x, center_x + y, center_y + x, color);
+        result |= oled_fillArea(center_x - y, center_y - x, center_x - y, center_y + x, color);
     }
     return result;
 }
 uint8_t oled_drawBitmap(uint8_t x, uint8_t y, const uint8_t *picture, uint8_t width, uint8_t height, uint8_t color){
-    uint8_t result,i,j, byteWidth = (width+7)/8;
-    for (j = 0; j < height; j++) {
-        for(i=0; i < width;i++){
-            if(pgm_read_byte(picture + j * byteWidth + i / 8) & (128 >> (i & 7))){
-                result = oled_drawPixel(x+i, y+j, color);
-            } else {
-                result = oled_drawPixel(x+i, y+j, !color);
+    uint8_t result = 0, byteWidth = (width+7)/8;
+    uint8_t rows[8];
+    
+    if( x+width > DISPLAY_WIDTH || y+height > DISPLAY_HEIGHT) result = 1; // clipped at display
+    
+    // picture is stored row by row, display by columns of 8 rows:
+    // take 8 rows of 8 columns from flash and turn them into 8 column bytes
+    for (uint8_t j = 0; j < height && y+j < DISPLAY_HEIGHT; j += 8) {
+        uint8_t bandMask = (height-j >= 8) ? 0xff : 0xff >> (8-(height-j));
+        uint8_t line = (y+j) >> 3;
+        uint8_t shift = (y+j) & 7;
+        uint16_t mask = (uint16_t)bandMask << shift;
+        
+        for (uint8_t k = 0; k < byteWidth; k++) {
+            for (uint8_t r = 0; r < 8; r++) {
+                rows[r] = (bandMask & (1 << r)) ? pgm_read_byte(picture + (j+r) * byteWidth + k) : 0;
+            }
+            for (uint8_t i = 8*k; i < 8*k+8 && i < width; i++) {
+                if( x+i > DISPLAY_WIDTH-1) break;
+                uint8_t column = 0;
+                for (uint8_t r = 0; r < 8; r++) {
+                    if( rows[r] & (128 >> (i & 7))) column |= (1 << r);
+                }
+                if( color != WHITE) column = ~column;
+                uint16_t bits = ((uint16_t)column << shift) & mask;
+                
+                if( LINE_IN_BUFFER(line)){
+                    BUFFER_LINE(line)[x+i] = (BUFFER_LINE(line)[x+i] & ~(uint8_t)mask) | (uint8_t)bits;
+                }
+                if( shift && line+1 < DISPLAY_HEIGHT/8 && LINE_IN_BUFFER(line+1)){
+                    BUFFER_LINE(line+1)[x+i] = (BUFFER_LINE(line+1)[x+i] & ~(uint8_t)(mask >> 8)) | (uint8_t)(bits >> 8);
+                }
             }
         }
     }
     return result;
 }
+uint8_t oled_font_putc(const oled_font_t *font, uint8_t x, uint8_t line, char c){
+    oled_font_t f;
+    memcpy_P(&f, font, sizeof(f));
+    uint8_t code = (uint8_t)c;
+    if (code < f.first || code > f.last) return 0; // no glyph
+    code -= f.first;
+    uint8_t width = pgm_read_byte(&f.width[code]);
+    const uint8_t *data = f.bitmap + pgm_read_word(&f.offset[code]);
+    // columns on display, glyph is clipped at right edge
+    uint8_t visible = (x < DISPLAY_WIDTH) ? ((width < DISPLAY_WIDTH - x) ? width : DISPLAY_WIDTH - x) : 0;
+    uint8_t run = 0, literal = 0, value = 0;
+    
+    for (uint8_t page = 0; page < f.pages; page++, line++) {
+        uint8_t inBuffer = line < DISPLAY_HEIGHT/8 && LINE_IN_BUFFER(line);
+        if (!(f.flags & OLED_FONT_RLE)) {
+            // glyph columns are buffer bytes, copy them as they are
+            if (inBuffer) memcpy_P(&BUFFER_LINE(line)[x], data, visible);
+            data += width;
+            continue;
+        }
+        for (uint8_t i = 0; i < width; i++) {
+            if (run == 0 && literal == 0) {
+                uint8_t control = pgm_read_byte(data++);
+                if (control & 0x80) {
+                    run = (control & 0x7F) + 1;
+                    value = pgm_read_byte(data++);
+                } else {
+                    literal = control + 1;
+                }
+            }
+            if (run) {
+                run--;
+            } else {
+                value = pgm_read_byte(data++);
+                literal--;
+            }
+            if (inBuffer && i < visible) BUFFER_LINE(line)[x+i] = value;
+        }
+    }
+    return width;
+}
+uint8_t oled_font_puts(const oled_font_t *font, uint8_t x, uint8_t line, const char *s){
+    uint16_t column = x;
+    while (*s && column < DISPLAY_WIDTH) {
+        column += oled_font_putc(font, column, line, *s++);
+    }
+    return (column < DISPLAY_WIDTH) ? column : DISPLAY_WIDTH;
+}
+uint8_t oled_font_width(const oled_font_t *font, const char *s){
+    oled_font_t f;
+    memcpy_P(&f, font, sizeof(f));
+    uint16_t width = 0;
+    for (; *s; s++) {
+        uint8_t code = (uint8_t)*s;
+        if (code >= f.first && code <= f.last) width += pgm_read_byte(&f.width[code - f.first]);
+    }
+    return (width < 0xff) ? width : 0xff;
+}
+#if defined PAGEMODE
+void oled_render(void (*draw)(void)) {
+    for (renderPage = 0; renderPage < DISPLAY_HEIGHT/8; renderPage++){
+        memset(displayBuffer, 0x00, sizeof(displayBuffer));
+        draw();
+        oled_data_at(0, renderPage, displayBuffer, sizeof(displayBuffer));
+    }
+}
+#elif defined GRAPHICMODE
 void oled_display() {
 #if defined (SSD1306) || defined (SSD1309)
-    oled_gotoxy(0,0);
-    oled_data(&displayBuffer[0][0], DISPLAY_WIDTH*DISPLAY_HEIGHT/8);
+    oled_data_at(0, 0, &displayBuffer[0][0], DISPLAY_WIDTH*DISPLAY_HEIGHT/8);
 #elif defined SH1106
     for (uint8_t i = 0; i < DISPLAY_HEIGHT/8; i++){
-        oled_gotoxy(0,i);
-        oled_data(displayBuffer[i], sizeof(displayBuffer[i]));
+        oled_data_at(0, i, displayBuffer[i], sizeof(displayBuffer[i]));
     }
 #endif
+    memset(dirtyBlock, 0x00, sizeof(dirtyBlock));
 }
+#endif
 void oled_clear_buffer() {
-    for (uint8_t i = 0; i < DISPLAY_HEIGHT/8; i++){
-        memset(displayBuffer[i], 0x00, sizeof(displayBuffer[i]));
-    }
+    memset(displayBuffer, 0x00, sizeof(displayBuffer));
 }
 uint8_t oled_check_buffer(uint8_t x, uint8_t y) {
     if( x > DISPLAY_WIDTH-1 || y > (DISPLAY_HEIGHT-1)) return 0; // out of Display
-    return displayBuffer[(y / (DISPLAY_HEIGHT/8))][x] & (1 << (y % (DISPLAY_HEIGHT/8)));
+    if( !LINE_IN_BUFFER(y / 8)) return 0; // not on the page actually rendered
+    return BUFFER_LINE(y / 8)[x] & (1 << (y % 8));
+}
+#if defined GRAPHICMODE
+void oled_mark_dirty(uint8_t x, uint8_t line, uint8_t width) {
+    if (line > (DISPLAY_HEIGHT/8-1) || x > DISPLAY_WIDTH - 1 || width == 0){return;}
+    if (x + width > DISPLAY_WIDTH) {
+        width = DISPLAY_WIDTH - x;
+    }
+    if (dirtyBlock[line].end == 0) {
+        dirtyBlock[line].first = x;
+        dirtyBlock[line].end = x + width;
+    } else {
+        if (x < dirtyBlock[line].first) dirtyBlock[line].first = x;
+        if (x + width > dirtyBlock[line].end) dirtyBlock[line].end = x + width;
+    }
+}
+void oled_display_dirty(void) {
+    for (uint8_t i = 0; i < DISPLAY_HEIGHT/8; i++){
+        if (dirtyBlock[i].end == 0) continue;
+        oled_display_block(dirtyBlock[i].first, i, dirtyBlock[i].end - dirtyBlock[i].first);
+        dirtyBlock[i].end = 0;
+    }
+}
+void oled_shift_block(uint8_t x, uint8_t line, uint8_t width) {
+    if (line > (DISPLAY_HEIGHT/8-1) || x > DISPLAY_WIDTH - 1 || width == 0){return;}
+    if (x + width > DISPLAY_WIDTH) {
+        width = DISPLAY_WIDTH - x;
+    }
+    memmove(&displayBuffer[line][x], &displayBuffer[line][x+1], width-1);
+    displayBuffer[line][x+width-1] = 0x00;
+    oled_mark_dirty(x, line, width);
 }
 void oled_display_block(uint8_t x, uint8_t line, uint8_t width) {
     if (line > (DISPLAY_HEIGHT/8-1) || x > DISPLAY_WIDTH - 1){return;}
     if (x + width > DISPLAY_WIDTH) { // no -1 here, x alone is width 1
         width = DISPLAY_WIDTH - x;
     }
-    oled_goto_xpix_y(x,line);
-    oled_data(&displayBuffer[line][x], width);
+    oled_data_at(x, line, &displayBuffer[line][x], width);
 }
 #endif
+#endif
@@ -39,6 +39,9 @@
  *
  *  at GRAPHICMODE lib needs SRAM for display
  *  DISPLAY-WIDTH * DISPLAY-HEIGHT + 2 bytes
+ *
+ *  at PAGEMODE lib needs SRAM for one page of display
+ *  DISPLAY-WIDTH + 3 bytes
  */
 
 #ifndef OLED_H
@@ -60,8 +63,11 @@ extern "C" {
     /* TODO: define displaycontroller */
 #define SH1106  // or SSD1306, check datasheet of your display
     /* TODO: define displaymode */
+#if !defined TEXTMODE && !defined PAGEMODE  // other mode may come from build flags (e.g. emulator)
 #define GRAPHICMODE  // for text and graphic
+#endif
     // TEXTMODE // for only text to display,
+    // PAGEMODE // for text and graphic, rendered page by page by oled_render()
     /* TODO: define font */
 #define FONT  ssd1306oled_font  // Refer font-name at font.h
     
@@ -82,6 +88,9 @@ extern "C" {
 # define RES_PIN  PB0
 # define DC_PIN   PB1
 # define CS_PIN   PB2
+# ifndef OLED_SPI_QUEUE_SIZE
+#  define OLED_SPI_QUEUE_SIZE 16  // transfers queued for background sending, power of 2
+# endif
 #endif
 
 #ifndef YES
@@ -96,14 +105,49 @@ extern "C" {
     
 #define WHITE 0x01
 #define BLACK 0x00
+
+#if defined (SSD1306) || defined (SSD1309)
+#define OLED_SCROLL_RIGHT 0x26
+#define OLED_SCROLL_LEFT 0x27
+#define OLED_SCROLL_VERTICAL_RIGHT 0x29
+#define OLED_SCROLL_VERTICAL_LEFT 0x2A
+    // scroll step interval in frames
+#define OLED_SCROLL_2_FRAMES 0x07
+#define OLED_SCROLL_3_FRAMES 0x04
+#define OLED_SCROLL_4_FRAMES 0x05
+#define OLED_SCROLL_5_FRAMES 0x00
+#define OLED_SCROLL_25_FRAMES 0x06
+#define OLED_SCROLL_64_FRAMES 0x01
+#define OLED_SCROLL_128_FRAMES 0x02
+#define OLED_SCROLL_256_FRAMES 0x03
+#endif
     
 #define DISPLAY_WIDTH 128
 #define DISPLAY_HEIGHT 64
 
+    // fonts generated by tools/fontconv.py (lib/oled/fonts), all members in flash
+#define OLED_FONT_RLE 0x01  // glyph data is run-length compressed
+typedef struct {
+    uint8_t first;          // code of first glyph
+    uint8_t last;           // code of last glyph
+    uint8_t pages;          // glyph height in display lines (pages)
+    uint8_t flags;          // OLED_FONT_...
+    const uint8_t *width;   // advance of each glyph in columns, 0 for missing glyph
+    const uint16_t *offset; // start of each glyph in bitmap
+    const uint8_t *bitmap;  // glyph columns page by page, bit 0 is top row of page
+} oled_font_t;
+
 // Transmit command or data to display
 void oled_command(uint8_t cmd[], uint8_t size);
 void oled_data(uint8_t data[], uint16_t size);
-void oled_init(uint8_t dispAttr);
+#if defined SPI
+uint8_t oled_busy(void);  // transfers of SPI running in background (e.g. oled_display()),
+                        // at GRAPHICMODE they send from the buffer itself: poll oled_busy()
+                        // before drawing again, else changed bytes may tear the frame.
+                        // With global interrupts off, transfers are sent at once (polled)
+#endif
+void oled_init(uint8_t dispAttr);  // dispAttr OLED_DISP_ON/OFF, at GRAPHICMODE the buffer is sent
+                        // instead of a clear, draw first frame (splash) before oled_init()
 void oled_home(void);  // set cursor to 0,0
 void oled_invert(uint8_t invert);  // invert display
 void oled_sleep(uint8_t sleep);    // display goto sleep (power off)
@@ -121,12 +165,26 @@ void oled_goto_xpix_y(uint8_t x, uint8_t y); // set curser at pos x, y. x means
 void oled_putc(char c);  // print character on screen at TEXTMODE
 // at GRAPHICMODE print character to buffer
 void oled_charMode(uint8_t mode);  // set size of chars
+void oled_set_start_line(uint8_t row);  // show display RAM from row (0...63) at top of display,
+                        // moves content without rewriting display RAM
+uint8_t oled_scroll_line(void);  // scroll up one line by display start line, returns line
+                        // (page of display RAM, set as cursor line) which appears at bottom,
+                        // at GRAPHICMODE its buffer is cleared, draw it and display only it
+                        // e.g. by oled_display_block(0, line, DISPLAY_WIDTH)
+                        // at TEXTMODE print the whole line to overwrite its old content
+#if defined (SSD1306) || defined (SSD1309)
+void oled_scroll_continuous(uint8_t direction, uint8_t startPage, uint8_t endPage, uint8_t interval, uint8_t verticalOffset);
+                        // start continuous hardware scroll of pages startPage...endPage,
+                        // direction OLED_SCROLL_..., interval OLED_SCROLL_..._FRAMES,
+                        // verticalOffset (rows per step) used only by vertical scroll
+void oled_scroll_stop(void);  // stop continuous scroll, rewrite display RAM afterwards
+#endif
 void oled_flip(uint8_t flipping);  // flip display, 
                     // flipping == 0: no flip (normal mode) 
                         // == 1: flip horizontal & vertical
                         // == 2: flip(mirrored) vertical
                         // == 3: flip(mirrored) horizontal
-#if defined GRAPHICMODE
+#if defined GRAPHICMODE || defined PAGEMODE
     uint8_t oled_drawPixel(uint8_t x, uint8_t y, uint8_t color);
     uint8_t oled_drawLine(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2, uint8_t color);
     uint8_t oled_drawRect(uint8_t px1, uint8_t py1, uint8_t px2, uint8_t py2, uint8_t color);
@@ -134,10 +192,27 @@ void oled_flip(uint8_t flipping);  // flip display,
     uint8_t oled_drawCircle(uint8_t center_x, uint8_t center_y, uint8_t radius, uint8_t color);
     uint8_t oled_fillCircle(uint8_t center_x, uint8_t center_y, uint8_t radius, uint8_t color);
     uint8_t oled_drawBitmap(uint8_t x, uint8_t y, const uint8_t picture[], uint8_t width, uint8_t height, uint8_t color);
-    void oled_display(void);       // copy buffer to display RAM
     void oled_clear_buffer(void);  // clear display buffer
     uint8_t oled_check_buffer(uint8_t x, uint8_t y); // read a pixel value from the display buffer
+    uint8_t oled_font_putc(const oled_font_t *font, uint8_t x, uint8_t line, char c);
+                        // copy glyph of font (in flash) to buffer at column x from display line
+                        // (page) line downwards, glyph background is cleared, returns advance
+    uint8_t oled_font_puts(const oled_font_t *font, uint8_t x, uint8_t line, const char *s);
+                        // print string with font, returns column after text
+    uint8_t oled_font_width(const oled_font_t *font, const char *s); // width of string in columns,
+                        // e.g. for right aligned readouts
+#endif
+#if defined GRAPHICMODE
+    void oled_display(void);       // copy buffer to display RAM
     void oled_display_block(uint8_t x, uint8_t line, uint8_t width); // display (part of) a display line
+    void oled_mark_dirty(uint8_t x, uint8_t line, uint8_t width); // mark part of a display line for oled_display_dirty()
+    void oled_display_dirty(void); // copy only marked parts of buffer to display RAM
+    void oled_shift_block(uint8_t x, uint8_t line, uint8_t width); // shift part of a buffer line one column left,
+                        // clear its last column and mark it dirty
+#elif defined PAGEMODE
+    void oled_render(void (*draw)(void)); // call draw() once per page into the page buffer
+                        // and send each page to display RAM, draw() has to
+                        // paint the whole screen with the functions above
 #endif
 
 #ifdef __cplusplus
@@ -0,0 +1,339 @@
+/**************************************************************************/
+/*!
+@file     shell.c
+@brief    Line-oriented command shell over UART
+@license  MIT
+
+Commands are read from the UART receive ring without waiting: every call
+of shell_poll() takes the bytes received so far, a complete line starts
+its command. Handlers reply one line per step and a step runs only when
+the transmit ring has room for a whole reply line, so neither input nor
+output ever stalls the main loop. Applications register named parameters
+(get/set) and their own commands as tables in flash.
+*/
+/**************************************************************************/
+
+#include "shell.h"
+#include <avr/io.h>
+#include <uart.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// Receive errors which make the current line unreliable
+#define SHELL_RX_ERRORS (UART_FRAME_ERROR | UART_OVERRUN_ERROR | UART_BUFFER_OVERFLOW)
+
+static uint8_t shell_help(char *args, uint8_t step);
+static uint8_t shell_list(char *args, uint8_t step);
+static uint8_t shell_get(char *args, uint8_t step);
+static uint8_t shell_set(char *args, uint8_t step);
+
+/// Built-in commands
+static const shell_command_t shell_builtins[] PROGMEM = {
+    {"help", shell_help},
+    {"list", shell_list},
+    {"get", shell_get},
+    {"set", shell_set},
+};
+
+#define SHELL_BUILTINS (sizeof(shell_builtins) / sizeof(shell_builtins[0]))
+
+/**************************************************************************/
+/*!
+@brief  Shell state
+*/
+/**************************************************************************/
+
+static struct {
+    const shell_param_t *params;    /*!< Parameter table in flash */
+    uint8_t paramCount;             /*!< Number of parameters */
+    const shell_command_t *commands; /*!< Command table in flash */
+    uint8_t commandCount;           /*!< Number of commands */
+    char line[SHELL_LINE_SIZE];     /*!< Received line */
+    uint8_t length;                 /*!< Bytes of received line */
+    uint8_t discard;                /*!< Line too long or damaged by receive error */
+    shell_handler_t handler;        /*!< Running command, NULL if none */
+    char *args;                     /*!< Arguments of running command */
+    uint8_t step;                   /*!< Next step of running command */
+    char *reply;                    /*!< Reply line of actual step, on stack of shell_poll() */
+    uint8_t replyLength;            /*!< Bytes of reply line */
+    uint16_t rxErrors;              /*!< Receive errors */
+} shell;
+
+/**************************************************************************/
+/*!
+@brief  Terminate first word and skip spaces after it
+
+@param[in] text  Text starting with a word
+
+@return Text after the word
+*/
+/**************************************************************************/
+
+static char *shell_split(char *text)
+{
+    while (*text != 0 && *text != ' ') text++;
+    while (*text == ' ') *text++ = 0;
+    return text;
+}
+
+/**************************************************************************/
+/*!
+@brief  Find parameter by name and copy its entry from flash
+
+@param[in]  name   Parameter name
+@param[out] param  Copy of entry
+
+@return 1 if found, 0 otherwise
+*/
+/**************************************************************************/
+
+static uint8_t shell_param_find(const char *name, shell_param_t *param)
+{
+    for (uint8_t i = 0; i < shell.paramCount; i++) {
+        if (strcmp_P(name, shell.params[i].name) == 0) {
+            memcpy_P(param, &shell.params[i], sizeof(*param));
+            return 1;
+        }
+    }
+    shell_printf_P(PSTR("unknown parameter %s"), name);
+    return 0;
+}
+
+/**************************************************************************/
+/*!
+@brief  Print parameter as "name = value"
+
+@param[in] param  Copy of parameter entry
+
+@return None
+*/
+/**************************************************************************/
+
+static void shell_param_print(const shell_param_t *param)
+{
+    switch (param->type) {
+    case SHELL_U8:
+        shell_printf_P(PSTR("%s = %u"), param->name, *(uint8_t *)param->value);
+        break;
+    case SHELL_U16:
+        shell_printf_P(PSTR("%s = %u"), param->name, *(uint16_t *)param->value);
+        break;
+    default:
+        shell_printf_P(PSTR("%s = %g"), param->name, *(float *)param->value);
+        break;
+    }
+}
+
+static uint8_t shell_help(char *args, uint8_t step)
+{
+    (void)args;
+    if (step == 0) {
+        shell_printf_P(PSTR("help, list, get <name>, set <name> <value>"));
+    } else {
+        shell_printf_P(shell.commands[step - 1].name);
+    }
+    return step < shell.commandCount;
+}
+
+static uint8_t shell_list(char *args, uint8_t step)
+{
+    shell_param_t param;
+
+    (void)args;
+    if (step >= shell.paramCount) return 0;
+    memcpy_P(&param, &shell.params[step], sizeof(param));
+    shell_param_print(&param);
+    return step + 1 < shell.paramCount;
+}
+
+static uint8_t shell_get(char *args, uint8_t step)
+{
+    shell_param_t param;
+
+    (void)step;
+    if (shell_param_find(args, &param)) shell_param_print(&param);
+    return 0;
+}
+
+static uint8_t shell_set(char *args, uint8_t step)
+{
+    shell_param_t param;
+    char *text = shell_split(args);
+    char *end;
+    float value;
+
+    (void)step;
+    if (!shell_param_find(args, &param)) return 0;
+    value = strtod(text, &end);
+    if (end == text || *shell_split(end) != 0) {
+        shell_printf_P(PSTR("bad value"));
+        return 0;
+    }
+    if (value < param.min || value > param.max) {
+        shell_printf_P(PSTR("%s: %g to %g"), param.name, param.min, param.max);
+        return 0;
+    }
+    switch (param.type) {
+    case SHELL_U8:
+        *(uint8_t *)param.value = value + 0.5f;
+        break;
+    case SHELL_U16:
+        *(uint16_t *)param.value = value + 0.5f;
+        break;
+    default:
+        *(float *)param.value = value;
+        break;
+    }
+    if (param.changed != NULL) param.changed();
+    shell_param_print(&param);
+    return 0;
+}
+
+static uint8_t shell_unknown(char *args, uint8_t step)
+{
+    (void)args;
+    (void)step;
+    shell_printf_P(PSTR("unknown command %s, try help"), shell.line);
+    return 0;
+}
+
+static uint8_t shell_discarded(char *args, uint8_t step)
+{
+    (void)args;
+    (void)step;
+    shell_printf_P(PSTR("line discarded"));
+    return 0;
+}
+
+/**************************************************************************/
+/*!
+@brief  Find handler of command in flash table
+
+@param[in] name      Command name
+@param[in] commands  Command table in flash
+@param[in] count     Number of commands
+
+@return Handler, NULL if not found
+*/
+/**************************************************************************/
+
+static shell_handler_t shell_find(const char *name, const shell_command_t *commands, uint8_t count)
+{
+    for (uint8_t i = 0; i < count; i++) {
+        if (strcmp_P(name, commands[i].name) == 0) {
+            return (shell_handler_t)pgm_read_ptr(&commands[i].run);
+        }
+    }
+    return NULL;
+}
+
+/**************************************************************************/
+/*!
+@brief  Start command of received line
+
+@return None
+*/
+/**************************************************************************/
+
+static void shell_start(void)
+{
+    char *word = shell.line;
+
+    while (*word == ' ') word++;
+    if (*word == 0) return;
+    memmove(shell.line, word, strlen(word) + 1);
+    shell.args = shell_split(shell.line);
+    shell.handler = shell_find(shell.line, shell_builtins, SHELL_BUILTINS);
+    if (shell.handler == NULL) {
+        shell.handler = shell_find(shell.line, shell.commands, shell.commandCount);
+    }
+    if (shell.handler == NULL) shell.handler = shell_unknown;
+}
+
+void shell_init(const shell_param_t *params, uint8_t paramCount,
+                const shell_command_t *commands, uint8_t commandCount)
+{
+    memset(&shell, 0, sizeof(shell));
+    shell.params = params;
+    shell.paramCount = paramCount;
+    shell.commands = commands;
+    shell.commandCount = commandCount;
+}
+
+void shell_poll(void)
+{
+    unsigned int received;
+    unsigned char *span;
+    char reply[SHELL_REPLY_SIZE];
+    uint8_t room;
+    uint8_t c;
+
+    if (shell.handler != NULL) {
+        // reply line, CR, LF and delimiter have to fit without waiting
+        room = uart_tx_reserve(0, &span);
+        room += uart_tx_reserve(room, &span);
+        if (room < SHELL_REPLY_SIZE + 2) return;
+
+        shell.reply = reply;
+        shell.replyLength = 0;
+        reply[0] = 0;
+        if (!shell.handler(shell.args, shell.step++)) {
+            shell.handler = NULL;
+            shell.step = 0;
+        }
+        shell.reply = NULL;
+        if (shell.replyLength != 0) {
+            uart_write(reply, shell.replyLength);
+            uart_write("\r\n", 3);  // with terminating zero as frame delimiter
+        }
+        return;
+    }
+
+    while (((received = uart_getc()) & UART_NO_DATA) == 0) {
+        if (received & SHELL_RX_ERRORS) {
+            if (shell.rxErrors < 0xFFFF) shell.rxErrors++;
+            shell.discard = 1;
+        }
+        c = received;
+        if (c == '\r' || c == '\n') {
+            if (shell.discard) {
+                shell.handler = shell_discarded;
+            } else {
+                shell.line[shell.length] = 0;
+                shell_start();
+            }
+            shell.length = 0;
+            shell.discard = 0;
+            if (shell.handler != NULL) return;   // rest of input waits in ring
+        } else if (c == '\b' || c == 0x7F) {
+            if (shell.length != 0) shell.length--;
+        } else if (shell.length < SHELL_LINE_SIZE - 1) {
+            shell.line[shell.length++] = c;
+        } else {
+            shell.discard = 1;
+        }
+    }
+}
+
+void shell_printf_P(PGM_P format, ...)
+{
+    va_list ap;
+    int size;
+
+    if (shell.reply == NULL) return;    // not inside a step
+    va_start(ap, format);
+    size = vsnprintf_P(shell.reply + shell.replyLength,
+                       SHELL_REPLY_SIZE - shell.replyLength, format, ap);
+    va_end(ap);
+    if (size > 0) {
+        size += shell.replyLength;
+        shell.replyLength = (size < SHELL_REPLY_SIZE) ? size : SHELL_REPLY_SIZE - 1;
+    }
+}
+
+uint16_t shell_rx_errors(void)
+{
+    return shell.rxErrors;
+}
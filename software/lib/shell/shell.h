@@ -0,0 +1,134 @@
+/**************************************************************************/
+/*!
+@file     shell.h
+@brief    Header for line-oriented command shell over UART
+*/
+/**************************************************************************/
+
+#ifndef SHELL_H
+#define SHELL_H
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+/// Size of command line buffer including terminating zero
+#ifndef SHELL_LINE_SIZE
+#define SHELL_LINE_SIZE 32
+#endif
+
+/// Size of one reply line including terminating zero
+#ifndef SHELL_REPLY_SIZE
+#define SHELL_REPLY_SIZE 48
+#endif
+
+/// Size of parameter and command names including terminating zero
+#define SHELL_NAME_SIZE 10
+
+/// Types of parameter values
+#define SHELL_U8    0   /*!< uint8_t */
+#define SHELL_U16   1   /*!< uint16_t */
+#define SHELL_FLOAT 2   /*!< float */
+
+/**************************************************************************/
+/*!
+@brief  Command handler
+
+Handler prints at most one reply line per call by shell_printf_P(). It is
+called again with the next step until it returns 0, so long output is
+split into lines which are sent only when the UART has room for them.
+
+@param[in] args  Arguments after command name, leading spaces removed
+@param[in] step  0 for first call, incremented for every further call
+
+@return 1 to be called again, 0 when done
+*/
+/**************************************************************************/
+
+typedef uint8_t (*shell_handler_t)(char *args, uint8_t step);
+
+/**************************************************************************/
+/*!
+@brief  Named parameter, tables of parameters are placed in flash
+*/
+/**************************************************************************/
+
+typedef struct {
+    char name[SHELL_NAME_SIZE]; /*!< Name used by get and set */
+    uint8_t type;               /*!< SHELL_U8, SHELL_U16 or SHELL_FLOAT */
+    void *value;                /*!< Variable in RAM */
+    float min;                  /*!< Smallest value accepted by set */
+    float max;                  /*!< Largest value accepted by set */
+    void (*changed)(void);      /*!< Called after set to apply value, or NULL */
+} shell_param_t;
+
+/**************************************************************************/
+/*!
+@brief  Named command, tables of commands are placed in flash
+*/
+/**************************************************************************/
+
+typedef struct {
+    char name[SHELL_NAME_SIZE]; /*!< Command name */
+    shell_handler_t run;        /*!< Handler */
+} shell_command_t;
+
+/**************************************************************************/
+/*!
+@brief  Initialize shell with parameters and commands of application
+
+Built-in commands are help, list, get <name> and set <name> <value>.
+
+@param[in] params        Parameter table in flash
+@param[in] paramCount    Number of parameters
+@param[in] commands      Command table in flash
+@param[in] commandCount  Number of commands
+
+@return None
+*/
+/**************************************************************************/
+
+void shell_init(const shell_param_t *params, uint8_t paramCount,
+                const shell_command_t *commands, uint8_t commandCount);
+
+/**************************************************************************/
+/*!
+@brief  Process received bytes and run pending command, never waits
+
+Call from main loop. Reads bytes from uart_getc() until a line is
+complete, then runs one handler step per call when the UART transmit
+ring has room for a reply line. Lines end with CR or LF, reply lines end
+with CR, LF and 0x00 so telemetry receivers see them as separate frames.
+
+@return None
+*/
+/**************************************************************************/
+
+void shell_poll(void);
+
+/**************************************************************************/
+/*!
+@brief  Append formatted text to reply line of running handler
+
+Text beyond SHELL_REPLY_SIZE-1 bytes is cut. The line lives on the stack of
+shell_poll(), outside of a handler nothing is appended.
+
+@param[in] format  printf format string in flash
+@param[in] ...     Arguments
+
+@return None
+*/
+/**************************************************************************/
+
+void shell_printf_P(PGM_P format, ...);
+
+/**************************************************************************/
+/*!
+@brief  Number of receive errors (framing, overrun, buffer overflow)
+
+@return Errors since shell_init(), saturates at 0xFFFF
+*/
+/**************************************************************************/
+
+uint16_t shell_rx_errors(void);
+
+#endif
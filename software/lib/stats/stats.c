@@ -0,0 +1,184 @@
+/**************************************************************************/
+/*!
+@file     stats.c
+@brief    Cascaded window statistics (Welford) in fixed point
+@license  MIT
+
+Every channel has one accumulator per level: mean, population variance,
+minimum and maximum of the items of the actual window. Level 0 takes
+samples, a completed window is an item of the next level. All windows of
+a level hold the same number of samples, so items are weighted equally
+and one Welford update serves every level: an item with mean x and
+variance v added as the k-th one changes mean M and variance V by
+
+    M' = M + (x - M) / k
+    V' = V + (v - V + (x - M)(x - M')) / k
+
+which needs no sums that grow with the window. Means carry 4 fraction
+bits, variances 2, so the variance of any int16 samples fits 32 bits; only
+the product of deviations takes 64 bits. A sample costs one update per
+channel, a completed window one more per channel on the next level.
+*/
+/**************************************************************************/
+
+#include "stats.h"
+
+/// Fraction bits of means
+#define STATS_MEAN_FRAC 4
+
+/// Fraction bits of variances, even so that the root has STATS_VAR_FRAC/2
+#define STATS_VAR_FRAC 2
+
+/// Window lengths of levels
+#define STATS_WINDOW(level) ((level) == 0 ? STATS_WINDOW0 : (level) == 1 ? STATS_WINDOW1 : STATS_WINDOW2)
+
+_Static_assert(STATS_LEVELS == 3, "STATS_WINDOW() covers three levels");
+_Static_assert(STATS_WINDOW0 <= 255 && STATS_WINDOW1 <= 255 && STATS_WINDOW2 <= 255,
+               "Windows are limited to 255 items");
+
+/**************************************************************************/
+/*!
+@brief  Accumulator of a channel on one level
+*/
+/**************************************************************************/
+
+typedef struct {
+    int32_t mean;       /*!< Mean of items, STATS_MEAN_FRAC fraction bits */
+    uint32_t var;       /*!< Variance of samples, STATS_VAR_FRAC fraction bits */
+    int16_t min;        /*!< Lowest sample */
+    int16_t max;        /*!< Highest sample */
+} stats_acc_t;
+
+/**************************************************************************/
+/*!
+@brief  Statistics state
+*/
+/**************************************************************************/
+
+static struct {
+    stats_acc_t acc[STATS_LEVELS][STATS_CHANNELS];  /*!< Accumulators */
+    uint8_t count[STATS_LEVELS];    /*!< Items in actual window, window length when complete */
+} stats;
+
+/**************************************************************************/
+/*!
+@brief  Divide rounded to nearest, also for negative values
+*/
+/**************************************************************************/
+
+static int32_t stats_div(int32_t value, uint8_t divisor)
+{
+    return (value >= 0) ? (value + divisor / 2) / divisor : -((-value + divisor / 2) / divisor);
+}
+
+/**************************************************************************/
+/*!
+@brief  Integer square root, rounded down
+*/
+/**************************************************************************/
+
+static uint16_t stats_sqrt(uint32_t value)
+{
+    uint32_t root = 0;
+    uint32_t bit = 1UL << 30;
+
+    while (bit > value) bit >>= 2;
+    while (bit != 0) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+/**************************************************************************/
+/*!
+@brief  Add k-th item to accumulator (Welford update)
+
+@param[in,out] acc   Accumulator
+@param[in]     k     Items including this one
+@param[in]     item  Mean, variance, minimum and maximum of item
+*/
+/**************************************************************************/
+
+static void stats_update(stats_acc_t *acc, uint8_t k, const stats_acc_t *item)
+{
+    int32_t delta;
+    int64_t change;
+
+    if (k == 1) {
+        *acc = *item;
+        return;
+    }
+    delta = item->mean - acc->mean;
+    acc->mean += stats_div(delta, k);
+
+    // (x - M)(x - M') is never negative, rounded to variance fraction bits
+    change = ((int64_t)delta * (item->mean - acc->mean) + (1 << (2 * STATS_MEAN_FRAC - STATS_VAR_FRAC - 1)))
+             >> (2 * STATS_MEAN_FRAC - STATS_VAR_FRAC);
+    change += (int64_t)item->var - acc->var;
+    change = (change >= 0) ? (change + k / 2) / k : -((-change + k / 2) / k);
+    acc->var = (change < 0 && (uint32_t)-change > acc->var) ? 0 : acc->var + change;
+
+    if (item->min < acc->min) acc->min = item->min;
+    if (item->max > acc->max) acc->max = item->max;
+}
+
+/**************************************************************************/
+/*!
+@brief  Count next item of level, a complete window starts again
+
+@return Items in window including the next one
+*/
+/**************************************************************************/
+
+static uint8_t stats_next(uint8_t level)
+{
+    if (stats.count[level] == STATS_WINDOW(level)) stats.count[level] = 0;
+    return ++stats.count[level];
+}
+
+uint8_t stats_add(const int16_t values[STATS_CHANNELS])
+{
+    stats_acc_t item;
+    uint8_t done = 0;
+    uint8_t level = 0;
+    uint8_t k;
+
+    k = stats_next(0);
+    item.var = 0;
+    for (uint8_t i = 0; i < STATS_CHANNELS; i++) {
+        item.mean = (int32_t)values[i] * (1 << STATS_MEAN_FRAC);
+        item.min = values[i];
+        item.max = values[i];
+        stats_update(&stats.acc[0][i], k, &item);
+    }
+
+    // completed window is the next item of the level above
+    while (stats.count[level] == STATS_WINDOW(level)) {
+        done |= 1 << level;
+        if (++level == STATS_LEVELS) break;
+        k = stats_next(level);
+        for (uint8_t i = 0; i < STATS_CHANNELS; i++) {
+            stats_update(&stats.acc[level][i], k, &stats.acc[level - 1][i]);
+        }
+    }
+    return done;
+}
+
+uint8_t stats_get(uint8_t level, uint8_t channel, stats_t *result)
+{
+    const stats_acc_t *acc;
+
+    if (level >= STATS_LEVELS || channel >= STATS_CHANNELS || stats.count[level] == 0) return 0;
+    acc = &stats.acc[level][channel];
+    result->mean = stats_div(acc->mean, 1 << STATS_MEAN_FRAC);
+    result->std = ((uint32_t)stats_sqrt(acc->var) + (1 << (STATS_VAR_FRAC / 2 - 1))) >> (STATS_VAR_FRAC / 2);
+    result->min = acc->min;
+    result->max = acc->max;
+    return stats.count[level];
+}
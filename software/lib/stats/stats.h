@@ -0,0 +1,85 @@
+/**************************************************************************/
+/*!
+@file     stats.h
+@brief    Header for cascaded window statistics (Welford) in fixed point
+*/
+/**************************************************************************/
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+
+/// Number of channels
+#define STATS_CHANNELS 4
+
+/// Number of window levels
+#define STATS_LEVELS 3
+
+/// Levels with one sample per second
+#define STATS_1MIN  0   /*!< Window of STATS_WINDOW0 samples */
+#define STATS_15MIN 1   /*!< Window of STATS_WINDOW1 one-minute windows */
+#define STATS_1H    2   /*!< Window of STATS_WINDOW2 15-minute windows */
+
+/// Samples of a window of level 0
+#ifndef STATS_WINDOW0
+#define STATS_WINDOW0 60
+#endif
+
+/// Windows of level 0 in a window of level 1
+#ifndef STATS_WINDOW1
+#define STATS_WINDOW1 15
+#endif
+
+/// Windows of level 1 in a window of level 2
+#ifndef STATS_WINDOW2
+#define STATS_WINDOW2 4
+#endif
+
+/**************************************************************************/
+/*!
+@brief  Statistics of a window, in units of the samples
+*/
+/**************************************************************************/
+
+typedef struct {
+    int16_t mean;       /*!< Rounded mean */
+    uint16_t std;       /*!< Rounded (population) standard deviation */
+    int16_t min;        /*!< Lowest sample */
+    int16_t max;        /*!< Highest sample */
+} stats_t;
+
+/**************************************************************************/
+/*!
+@brief  Add sample of all channels, O(1)
+
+A window that completes passes its mean, variance, minimum and maximum on
+to the window of the next level. It stays readable by stats_get() until
+its level gets the first item of the next window.
+
+@param[in] values  Sample of all channels
+
+@return Bit n set if the window of level n completed with this sample
+*/
+/**************************************************************************/
+
+uint8_t stats_add(const int16_t values[STATS_CHANNELS]);
+
+/**************************************************************************/
+/*!
+@brief  Statistics of the actual window of a level
+
+After stats_add() reported the level, the window is complete until the
+next window starts. Otherwise it is the part collected so far.
+
+@param[in]  level    Level (0 to STATS_LEVELS-1)
+@param[in]  channel  Channel (0 to STATS_CHANNELS-1)
+@param[out] result   Statistics
+
+@return Items in the window (samples or windows of the level below), 0 if empty
+*/
+/**************************************************************************/
+
+uint8_t stats_get(uint8_t level, uint8_t channel, stats_t *result);
+
+#endif
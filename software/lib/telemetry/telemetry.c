@@ -0,0 +1,249 @@
+/**************************************************************************/
+/*!
+@file     telemetry.c
+@brief    Binary telemetry records framed by COBS and CRC-16
+@license  MIT
+
+Samples are serialized into a fixed little-endian record, protected by
+CRC-16 and framed with Consistent Overhead Byte Stuffing (COBS): the
+encoded frame contains no 0x00, so 0x00 delimits frames and a receiver
+resynchronizes after any lost byte. Frames are encoded in place in the
+UART transmit ring. Record layout (offset, size):
+
+- 0 (1)  type TELEMETRY_TYPE_SAMPLE
+- 1 (1)  sequence number
+- 2 (4)  timestamp
+- 6 (2)  raw ADC of MQ-135
+- 8 (2)  raw ADC of dust sensor
+- 10 (4) raw DHT12 bytes
+- 14 (2) temperature, 16 (2) humidity, 18 (2) CO2, 20 (2) dust
+- 22 (1) flags
+
+Block record of a bulk transfer (lib/transfer):
+
+- 0 (1)  type TELEMETRY_TYPE_BLOCK
+- 1 (1)  source
+- 2 (2)  block number
+- 4 (n)  data, at most UART_TX_BUFFER_SIZE-9 bytes
+
+Stats record of a window (lib/stats), 8 bytes per channel:
+
+- 0 (1)  type TELEMETRY_TYPE_STATS
+- 1 (1)  level
+- 2 (1)  items in window
+- 3 (2)  mean, 5 (2) standard deviation, 7 (2) minimum, 9 (2) maximum
+  of channel 0, the other channels follow
+*/
+/**************************************************************************/
+
+#include "telemetry.h"
+#include <avr/io.h>
+#include <uart.h>
+#include <util/crc16.h>
+
+/// Encoded frame of record: COBS overhead of one byte, CRC and delimiter
+#define FRAME_SIZE(record) ((uint16_t)(record) + 2 + 1 + 1)
+
+// a frame that fits the ring has less than 254 bytes of record and CRC,
+// so COBS never needs a code byte within a run of nonzero bytes
+_Static_assert(UART_TX_BUFFER_SIZE <= 256, "Frames are limited to 255 bytes");
+
+static uint8_t sequence; /*!< Sequence number of next record */
+
+/**************************************************************************/
+/*!
+@brief  COBS encoder writing into reserved space of UART transmit ring
+
+Reserved space consists of two spans when the ring wraps around. Code
+bytes are written back into reserved space, nothing is sent before the
+frame is complete.
+*/
+/**************************************************************************/
+
+static struct {
+    uint8_t *span[2];   /*!< Reserved spans */
+    uint8_t size;       /*!< Bytes of first span */
+    uint8_t out;        /*!< Bytes written */
+    uint8_t codeIndex;  /*!< Position of code byte of actual block */
+    uint8_t code;       /*!< 1 + number of bytes in actual block */
+    uint16_t crc;       /*!< CRC of record bytes */
+} frame;
+
+/**************************************************************************/
+/*!
+@brief  Write byte at position of reserved space
+
+@param[in] index  Position
+@param[in] byte   Byte
+
+@return None
+*/
+/**************************************************************************/
+
+static void frame_store(uint8_t index, uint8_t byte)
+{
+    if (index < frame.size) {
+        frame.span[0][index] = byte;
+    } else {
+        frame.span[1][index - frame.size] = byte;
+    }
+}
+
+/**************************************************************************/
+/*!
+@brief  Add record byte to CRC and encode it by COBS
+
+Record is shorter than 254 bytes, so blocks end only at zero bytes.
+
+@param[in] byte  Record byte
+
+@return None
+*/
+/**************************************************************************/
+
+static void frame_put(uint8_t byte)
+{
+    if (byte == 0) {
+        frame_store(frame.codeIndex, frame.code);
+        frame.codeIndex = frame.out++;
+        frame.code = 1;
+    } else {
+        frame_store(frame.out++, byte);
+        frame.code++;
+    }
+}
+
+/**************************************************************************/
+/*!
+@brief  Put record byte and update CRC
+
+@param[in] byte  Record byte
+
+@return None
+*/
+/**************************************************************************/
+
+static void record_put(uint8_t byte)
+{
+    frame.crc = _crc16_update(frame.crc, byte);
+    frame_put(byte);
+}
+
+/**************************************************************************/
+/*!
+@brief  Put 16-bit record value little-endian
+
+@param[in] value  Value
+
+@return None
+*/
+/**************************************************************************/
+
+static void record_put16(uint16_t value)
+{
+    record_put(value);
+    record_put(value >> 8);
+}
+
+/**************************************************************************/
+/*!
+@brief  Reserve space of frame in UART transmit ring and start encoder
+
+@param[in] size    Bytes of record
+@param[in] policy  UART_TX_BLOCK, UART_TX_DROP or UART_TX_OVERWRITE
+
+@return 1 if frame fits, 0 if it is dropped or larger than the ring
+*/
+/**************************************************************************/
+
+static uint8_t frame_begin(uint16_t size, uint8_t policy)
+{
+    // ring keeps one byte free, a larger frame would never fit
+    if (FRAME_SIZE(size) > UART_TX_BUFFER_SIZE - 1) return 0;
+    if (!uart_tx_room(FRAME_SIZE(size), policy)) return 0;
+    frame.size = uart_tx_reserve(0, &frame.span[0]);
+    uart_tx_reserve(frame.size, &frame.span[1]);
+
+    frame.out = 1;
+    frame.codeIndex = 0;
+    frame.code = 1;
+    frame.crc = 0xFFFF;
+    return 1;
+}
+
+/**************************************************************************/
+/*!
+@brief  Append CRC and delimiter and send frame
+
+@return None
+*/
+/**************************************************************************/
+
+static void frame_end(void)
+{
+    uint16_t crc = frame.crc;
+
+    frame_put(crc);
+    frame_put(crc >> 8);
+    frame_store(frame.codeIndex, frame.code);
+    frame_store(frame.out++, 0x00);     // delimiter
+    uart_tx_commit(frame.out);
+}
+
+uint8_t telemetry_send(const telemetry_sample_t *sample, uint8_t policy)
+{
+    // whole frame or nothing, receiver sees the gap in sequence numbers
+    if (!frame_begin(TELEMETRY_SAMPLE_SIZE, policy)) {
+        sequence++;
+        return 0;
+    }
+
+    record_put(TELEMETRY_TYPE_SAMPLE);
+    record_put(sequence++);
+    record_put16(sample->timestamp);
+    record_put16(sample->timestamp >> 16);
+    record_put16(sample->adcCO2);
+    record_put16(sample->adcDust);
+    for (uint8_t i = 0; i < sizeof(sample->dht12); i++) {
+        record_put(sample->dht12[i]);
+    }
+    record_put16(sample->temperature);
+    record_put16(sample->humidity);
+    record_put16(sample->co2);
+    record_put16(sample->dust);
+    record_put(sample->flags);
+    frame_end();
+    return 1;
+}
+
+uint8_t telemetry_send_block(uint8_t source, uint16_t block, const uint8_t *data, uint8_t size, uint8_t policy)
+{
+    if (!frame_begin((uint16_t)TELEMETRY_BLOCK_HEADER + size, policy)) return 0;
+
+    record_put(TELEMETRY_TYPE_BLOCK);
+    record_put(source);
+    record_put16(block);
+    for (uint8_t i = 0; i < size; i++) record_put(data[i]);
+    frame_end();
+    return 1;
+}
+
+uint8_t telemetry_send_stats(uint8_t level, uint8_t policy)
+{
+    stats_t result;
+
+    if (!frame_begin(TELEMETRY_STATS_SIZE, policy)) return 0;
+
+    record_put(TELEMETRY_TYPE_STATS);
+    record_put(level);
+    record_put(stats_get(level, 0, &result));
+    for (uint8_t i = 0; i < STATS_CHANNELS; i++) {
+        stats_get(level, i, &result);
+        record_put16(result.mean);
+        record_put16(result.std);
+        record_put16(result.min);
+        record_put16(result.max);
+    }
+    frame_end();
+    return 1;
+}
@@ -0,0 +1,126 @@
+/**************************************************************************/
+/*!
+@file     telemetry.h
+@brief    Header for binary telemetry records framed by COBS and CRC-16
+*/
+/**************************************************************************/
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include <stats.h>
+
+/// Record type of a sensor sample
+#define TELEMETRY_TYPE_SAMPLE 0x01
+
+/// Record type of a block of a bulk transfer
+#define TELEMETRY_TYPE_BLOCK 0x02
+
+/// Record type of window statistics
+#define TELEMETRY_TYPE_STATS 0x03
+
+/// Bytes of encoded sample record: type, sequence number and fields
+#define TELEMETRY_SAMPLE_SIZE 23
+
+/// Bytes of block record before data: type, source and block number
+#define TELEMETRY_BLOCK_HEADER 4
+
+/// Bytes of frame of block record with size bytes of data, see telemetry_send_block()
+#define TELEMETRY_BLOCK_FRAME(size) (TELEMETRY_BLOCK_HEADER + (size) + 4)
+
+/// Bytes of stats record: type, level, items and four values per channel
+#define TELEMETRY_STATS_SIZE (3 + 8 * STATS_CHANNELS)
+
+/// Status flags of sample record
+#define TELEMETRY_FLAG_ALERT    0x01  /*!< CO2 alert output of MQ-135 module active */
+#define TELEMETRY_FLAG_OVERRUN  0x02  /*!< Samples were lost since the previous record */
+#define TELEMETRY_FLAG_VALUES   0x04  /*!< Computed values are valid */
+
+/**************************************************************************/
+/*!
+@brief  Sensor sample
+
+Raw codes are sent as read, computed values in fixed point. Record is
+serialized little-endian without padding, see telemetry_send().
+*/
+/**************************************************************************/
+
+typedef struct {
+    uint32_t timestamp;     /*!< Time of dust sample in Timer1 ticks (16 us) */
+    uint16_t adcCO2;        /*!< Raw ADC code of MQ-135 */
+    uint16_t adcDust;       /*!< Raw ADC code of GP2Y1010AU0F */
+    uint8_t dht12[4];       /*!< Raw humidity and temperature bytes of DHT12 */
+    int16_t temperature;    /*!< Temperature in 0.1 °C */
+    uint16_t humidity;      /*!< Relative humidity in 0.1 % */
+    uint16_t co2;           /*!< CO2 concentration in ppm */
+    uint16_t dust;          /*!< Dust concentration in 0.1 ug/m3 */
+    uint8_t flags;          /*!< TELEMETRY_FLAG_... */
+} telemetry_sample_t;
+
+/**************************************************************************/
+/*!
+@brief  Send sample record over UART
+
+Frame on the wire is COBS(record, CRC-16) followed by 0x00 delimiter.
+CRC-16 is CRC-16/MODBUS (polynomial 0xA001 reflected, init 0xFFFF) of
+the record, appended low byte first. Every record gets the next 8-bit
+sequence number, so a receiver can count lost frames.
+
+Frame is encoded in place in the UART transmit ring. When the ring has
+no space for the whole frame, policy decides: UART_TX_BLOCK waits,
+UART_TX_OVERWRITE discards oldest queued bytes, UART_TX_DROP drops the
+frame. A dropped frame still uses its sequence number and is counted by
+uart_tx_dropped().
+
+@param[in] sample  Sample to send
+@param[in] policy  UART_TX_BLOCK, UART_TX_DROP or UART_TX_OVERWRITE
+
+@return 1 if frame is queued, 0 if dropped
+*/
+/**************************************************************************/
+
+uint8_t telemetry_send(const telemetry_sample_t *sample, uint8_t policy);
+
+/**************************************************************************/
+/*!
+@brief  Send block record of a bulk transfer over UART
+
+Framed like a sample record: COBS(record, CRC-16) and 0x00 delimiter,
+TELEMETRY_BLOCK_FRAME(size) bytes in the transmit ring. Record is type
+TELEMETRY_TYPE_BLOCK, source, 16-bit block number (little-endian) and
+data. Blocks have no sequence number of their own.
+
+@param[in] source  Source of data, defined by the application
+@param[in] block   Block number
+@param[in] data    Data
+@param[in] size    Bytes of data, at most UART_TX_BUFFER_SIZE-9 (55 with
+                   the ring of 64 bytes), a larger block is dropped
+@param[in] policy  UART_TX_BLOCK, UART_TX_DROP or UART_TX_OVERWRITE
+
+@return 1 if block was queued, 0 if it was dropped
+*/
+/**************************************************************************/
+
+uint8_t telemetry_send_block(uint8_t source, uint16_t block, const uint8_t *data, uint8_t size, uint8_t policy);
+
+/**************************************************************************/
+/*!
+@brief  Send statistics of a window over UART
+
+Framed like a sample record, takes TELEMETRY_STATS_SIZE+4 bytes in the
+transmit ring. Record is type TELEMETRY_TYPE_STATS, level, items in the
+window, then mean, standard deviation, minimum and maximum of every
+channel as read by stats_get(). Call it right after stats_add() reported
+the level, then the window is complete.
+
+@param[in] level   Level of lib/stats
+@param[in] policy  UART_TX_BLOCK, UART_TX_DROP or UART_TX_OVERWRITE
+
+@return 1 if record was queued, 0 if it was dropped
+*/
+/**************************************************************************/
+
+uint8_t telemetry_send_stats(uint8_t level, uint8_t policy);
+
+#endif
@@ -0,0 +1,108 @@
+/**************************************************************************/
+/*!
+@file     transfer.c
+@brief    Windowed bulk transfer of stored records over UART
+@license  MIT
+
+Items of a source (records of history or EEPROM log) are packed into
+blocks and sent as block records of lib/telemetry, COBS framed with
+CRC-16, so they share the line with telemetry and shell replies. Up to
+TRANSFER_WINDOW blocks are sent ahead of the last acknowledged one. The
+receiver acknowledges received blocks cumulatively and asks for a block
+again after a bad or missing frame, every block from there on is resent
+(go-back-N). A nak acknowledges the blocks before it as well, so a lost
+ack never closes the window for good. Blocks are read from the source only when the transmit
+ring has room for the whole frame, so nothing is buffered twice.
+*/
+/**************************************************************************/
+
+#include "transfer.h"
+#include <avr/io.h>
+#include <uart.h>
+#include <telemetry.h>
+
+#if TELEMETRY_BLOCK_FRAME(TRANSFER_BLOCK_SIZE) > UART_TX_BUFFER_SIZE - 1
+# error "Frame of a full block does not fit into UART transmit ring"
+#endif
+
+/**************************************************************************/
+/*!
+@brief  Transfer state
+*/
+/**************************************************************************/
+
+static struct {
+    transfer_read_t read;   /*!< Reader of items, NULL if no transfer runs */
+    uint16_t items;         /*!< Number of items */
+    uint16_t blocks;        /*!< Number of blocks */
+    uint16_t base;          /*!< First block not acknowledged */
+    uint16_t next;          /*!< Next block to send */
+    uint8_t itemSize;       /*!< Bytes of an item */
+    uint8_t perBlock;       /*!< Items per block */
+    uint8_t source;         /*!< Source number */
+} transfer;
+
+uint16_t transfer_start(uint8_t source, transfer_read_t read, uint16_t items, uint8_t itemSize)
+{
+    transfer.read = read;
+    transfer.items = items;
+    transfer.itemSize = itemSize;
+    transfer.perBlock = TRANSFER_BLOCK_SIZE / itemSize;
+    transfer.blocks = (items + transfer.perBlock - 1) / transfer.perBlock;
+    transfer.base = 0;
+    transfer.next = 0;
+    transfer.source = source;
+    if (transfer.blocks == 0) transfer.read = NULL;
+    return transfer.blocks;
+}
+
+void transfer_ack(uint16_t block)
+{
+    if (transfer.read == NULL || block <= transfer.base || block > transfer.next) return;
+    transfer.base = block;
+    if (transfer.base == transfer.blocks) transfer.read = NULL;
+}
+
+void transfer_nak(uint16_t block)
+{
+    if (transfer.read == NULL || block < transfer.base || block > transfer.next) return;
+    transfer.base = block;      // earlier blocks arrived, their ack may be lost
+    transfer.next = block;
+}
+
+void transfer_stop(void)
+{
+    transfer.read = NULL;
+}
+
+uint8_t transfer_active(void)
+{
+    return transfer.read != NULL;
+}
+
+void transfer_poll(void)
+{
+    uint8_t data[TRANSFER_BLOCK_SIZE];
+    uint16_t item;
+    uint8_t size = 0;
+    unsigned char *span;
+    uint8_t room;
+
+    if (transfer.read == NULL || transfer.next == transfer.blocks ||
+        transfer.next - transfer.base >= TRANSFER_WINDOW) return;
+
+    // whole frame has to fit, free space of both spans of the ring
+    room = uart_tx_reserve(0, &span);
+    room += uart_tx_reserve(room, &span);
+    if (room < TELEMETRY_BLOCK_FRAME(TRANSFER_BLOCK_SIZE)) return;
+
+    item = transfer.next * transfer.perBlock;
+    for (uint8_t i = 0; i < transfer.perBlock && item < transfer.items; i++, item++) {
+        if (!transfer.read(item, &data[size])) {
+            transfer.read = NULL;
+            return;
+        }
+        size += transfer.itemSize;
+    }
+    telemetry_send_block(transfer.source, transfer.next++, data, size, UART_TX_DROP);
+}
@@ -0,0 +1,108 @@
+/**************************************************************************/
+/*!
+@file     transfer.h
+@brief    Header for windowed bulk transfer of stored records over UART
+*/
+/**************************************************************************/
+
+#ifndef TRANSFER_H
+#define TRANSFER_H
+
+#include <stdint.h>
+
+/// Most bytes of data of one block
+#ifndef TRANSFER_BLOCK_SIZE
+#define TRANSFER_BLOCK_SIZE 32
+#endif
+
+/// Blocks sent ahead of the last acknowledged one
+#ifndef TRANSFER_WINDOW
+#define TRANSFER_WINDOW 8
+#endif
+
+/**************************************************************************/
+/*!
+@brief  Read item of source
+
+@param[in]  item  Index of item
+@param[out] data  Bytes of item
+
+@return 1 if item was read, 0 if the source changed and the transfer ends
+*/
+/**************************************************************************/
+
+typedef uint8_t (*transfer_read_t)(uint16_t item, uint8_t *data);
+
+/**************************************************************************/
+/*!
+@brief  Start transfer of items, a running transfer is replaced
+
+Blocks carry as many whole items as fit into TRANSFER_BLOCK_SIZE, the
+last block may be shorter. Items are read again when a block is resent.
+
+@param[in] source    Source number sent in every block
+@param[in] read      Reader of items
+@param[in] items     Number of items
+@param[in] itemSize  Bytes of an item (1 to TRANSFER_BLOCK_SIZE)
+
+@return Number of blocks
+*/
+/**************************************************************************/
+
+uint16_t transfer_start(uint8_t source, transfer_read_t read, uint16_t items, uint8_t itemSize);
+
+/**************************************************************************/
+/*!
+@brief  Acknowledge all blocks before block, the transfer ends after the last one
+
+@param[in] block  First block not received yet
+
+@return None
+*/
+/**************************************************************************/
+
+void transfer_ack(uint16_t block);
+
+/**************************************************************************/
+/*!
+@brief  Send again from block on (go-back-N), acknowledges blocks before it
+
+@param[in] block  First block to send again
+
+@return None
+*/
+/**************************************************************************/
+
+void transfer_nak(uint16_t block);
+
+/**************************************************************************/
+/*!
+@brief  Stop running transfer
+
+@return None
+*/
+/**************************************************************************/
+
+void transfer_stop(void);
+
+/**************************************************************************/
+/*!
+@brief  Transfer is running
+
+@return 1 if running, 0 otherwise
+*/
+/**************************************************************************/
+
+uint8_t transfer_active(void);
+
+/**************************************************************************/
+/*!
+@brief  Send next block of window when the UART transmit ring has room, never waits
+
+@return None
+*/
+/**************************************************************************/
+
+void transfer_poll(void);
+
+#endif
@@ -39,6 +39,7 @@
 #include <avr/io.h>
 #include <avr/interrupt.h>
 #include <avr/pgmspace.h>
+#include <string.h>
 #include "uart.h"
 
 
@@ -56,6 +57,10 @@
 #if ( UART_TX_BUFFER_SIZE & UART_TX_BUFFER_MASK )
 # error TX buffer size is not a power of 2
 #endif
+#define UART_TX_SPANS_MASK ( UART_TX_SPANS - 1)
+#if ( UART_TX_SPANS & UART_TX_SPANS_MASK )
+# error TX span descriptor count is not a power of 2
+#endif
 
 
 #if defined(__AVR_AT90S2313__) || defined(__AVR_AT90S4414__) || defined(__AVR_AT90S8515__) || \
@@ -346,6 +351,21 @@ static volatile unsigned char UART_RxHead;
 static volatile unsigned char UART_RxTail;
 static volatile unsigned char UART_LastRxError;
 
+/* spans sent by UDRE interrupt from RAM or flash, each after the ringbuffer
+   bytes up to its mark */
+static volatile struct {
+    const unsigned char *data;  /* next byte */
+    unsigned int size;          /* bytes not yet sent */
+    unsigned char flags;        /* UART_TX_RAM or UART_TX_FLASH */
+    unsigned char mark;         /* UART_TxHead when queued */
+} UART_TxSpan[UART_TX_SPANS];
+static volatile unsigned char UART_TxSpanHead;
+static volatile unsigned char UART_TxSpanTail;
+
+/* TX policy accounting */
+static unsigned int UART_TxDropped;
+static unsigned char UART_TxHighWater;
+
 #if defined( ATMEGA_USART1 )
 static volatile unsigned char UART1_TxBuf[UART_TX_BUFFER_SIZE];
 static volatile unsigned char UART1_RxBuf[UART_RX_BUFFER_SIZE];
@@ -357,6 +377,11 @@ static volatile unsigned char UART1_LastRxError;
 #endif
 
 
+#ifdef UART_RX_HOOK
+extern void UART_RX_HOOK(void);
+#endif
+
+
 ISR(UART0_RECEIVE_INTERRUPT)
 
 /*************************************************************************
@@ -401,6 +426,10 @@ ISR(UART0_RECEIVE_INTERRUPT)
         UART_RxBuf[tmphead] = data;
     }
     UART_LastRxError |= lastRxError;
+
+    #ifdef UART_RX_HOOK
+    UART_RX_HOOK();
+    #endif
 }
 
 
@@ -412,9 +441,21 @@ ISR(UART0_TRANSMIT_INTERRUPT)
  **************************************************************************/
 {
     unsigned char tmptail;
+    unsigned char spantail = UART_TxSpanTail;
 
 
-    if (UART_TxHead != UART_TxTail)
+    if (spantail != UART_TxSpanHead && UART_TxSpan[spantail].mark == UART_TxTail)
+    {
+        /* ringbuffer sent up to the span, send next byte of span */
+        const unsigned char *data = UART_TxSpan[spantail].data;
+        UART0_DATA = (UART_TxSpan[spantail].flags & UART_TX_FLASH) ? pgm_read_byte(data) : *data;
+        UART_TxSpan[spantail].data = data + 1;
+        if (--UART_TxSpan[spantail].size == 0)
+        {
+            UART_TxSpanTail = (spantail + 1) & UART_TX_SPANS_MASK;
+        }
+    }
+    else if (UART_TxHead != UART_TxTail)
     {
         /* calculate and store new buffer index */
         tmptail     = (UART_TxTail + 1) & UART_TX_BUFFER_MASK;
@@ -440,6 +481,10 @@ void uart_init(unsigned int baudrate)
 {
     UART_TxHead = 0;
     UART_TxTail = 0;
+    UART_TxSpanHead = 0;
+    UART_TxSpanTail = 0;
+    UART_TxDropped = 0;
+    UART_TxHighWater = 0;
     UART_RxHead = 0;
     UART_RxTail = 0;
 
@@ -461,14 +506,19 @@ void uart_init(unsigned int baudrate)
     #endif /* ifdef UART_TEST */
 
     /* Set baud rate */
+    #if UART0_BIT_U2X
     if (baudrate & 0x8000)
     {
-        #if UART0_BIT_U2X
         UART0_STATUS = (1 << UART0_BIT_U2X); // Enable 2x speed
-        #endif
     }
+    else
+    {
+        UART0_STATUS = 0;                    // Normal speed
+    }
+    #endif
+    baudrate &= ~0x8000;
     #if defined(UART0_UBRRH)
-    UART0_UBRRH = (unsigned char) ((baudrate >> 8) & 0x80);
+    UART0_UBRRH = (unsigned char) (baudrate >> 8);
     #endif
     UART0_UBRRL = (unsigned char) (baudrate & 0x00FF);
 
@@ -517,6 +567,70 @@ unsigned int uart_getc(void)
     return (lastRxError << 8) + data;
 }/* uart_getc */
 
+/*************************************************************************
+ * Function: uart_tx_level()
+ * Purpose:  update high-water mark of transmit ringbuffer
+ * Returns:  none
+ **************************************************************************/
+static void uart_tx_level(void)
+{
+    unsigned char used = (UART_TxHead - UART_TxTail) & UART_TX_BUFFER_MASK;
+
+    if (used > UART_TxHighWater)
+    {
+        UART_TxHighWater = used;
+    }
+}/* uart_tx_level */
+
+/*************************************************************************
+ * Function: uart_tx_drop()
+ * Purpose:  count dropped bytes
+ * Input:    number of bytes
+ * Returns:  none
+ **************************************************************************/
+static void uart_tx_drop(unsigned int count)
+{
+    UART_TxDropped = (count < 0xFFFF - UART_TxDropped) ? UART_TxDropped + count : 0xFFFF;
+}/* uart_tx_drop */
+
+/*************************************************************************
+ * Function: uart_tx_discard()
+ * Purpose:  discard oldest bytes of transmit ringbuffer to get free space
+ * Input:    free space needed
+ * Returns:  none
+ **************************************************************************/
+static void uart_tx_discard(unsigned int size)
+{
+    unsigned char sreg = SREG;
+    unsigned char tail;
+    unsigned char free;
+    unsigned char limit;
+
+
+    cli();
+    tail = UART_TxTail;
+    free = (tail - UART_TxHead - 1) & UART_TX_BUFFER_MASK;
+    if (size > free)
+    {
+        /* bytes before the mark of a pending span keep their place */
+        if (UART_TxSpanHead != UART_TxSpanTail)
+        {
+            limit = (UART_TxSpan[UART_TxSpanTail].mark - tail) & UART_TX_BUFFER_MASK;
+        }
+        else
+        {
+            limit = (UART_TxHead - tail) & UART_TX_BUFFER_MASK;
+        }
+        if (size - free < limit)
+        {
+            limit = size - free;
+        }
+        UART_TxTail = (tail + limit) & UART_TX_BUFFER_MASK;
+        uart_tx_drop(limit);
+    }
+    SREG = sreg;
+}/* uart_tx_discard */
+
 /*************************************************************************
  * Function: uart_putc()
  * Purpose:  write byte to ringbuffer for transmitting via UART
@@ -537,11 +651,231 @@ void uart_putc(unsigned char data)
 
     UART_TxBuf[tmphead] = data;
     UART_TxHead         = tmphead;
+    uart_tx_level();
 
     /* enable UDRE interrupt */
     UART0_CONTROL |= _BV(UART0_UDRIE);
 }/* uart_putc */
 
+/*************************************************************************
+ * Function: uart_tx_reserve()
+ * Purpose:  get contiguous free space of transmit ringbuffer
+ * Input:    offset of span behind bytes already reserved
+ *           pointer to span pointer
+ * Returns:  number of bytes of span, 0 if buffer is full
+ **************************************************************************/
+unsigned char uart_tx_reserve(unsigned char offset, unsigned char **span)
+{
+    unsigned char head = UART_TxHead;
+    unsigned char free = (UART_TxTail - head - 1) & UART_TX_BUFFER_MASK;
+    unsigned char start;
+
+
+    if (offset >= free)
+    {
+        return 0;
+    }
+    /* head is the last written byte, free space starts behind it */
+    start = (head + 1 + offset) & UART_TX_BUFFER_MASK;
+    free -= offset;
+    *span = (unsigned char *)&UART_TxBuf[start];
+
+    /* span ends at end of buffer, the rest is returned for next offset */
+    if (free > UART_TX_BUFFER_SIZE - start)
+    {
+        free = UART_TX_BUFFER_SIZE - start;
+    }
+    return free;
+}/* uart_tx_reserve */
+
+/*************************************************************************
+ * Function: uart_tx_commit()
+ * Purpose:  transmit bytes written into reserved spans
+ * Input:    number of bytes
+ * Returns:  none
+ **************************************************************************/
+void uart_tx_commit(unsigned char count)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    UART_TxHead = (UART_TxHead + count) & UART_TX_BUFFER_MASK;
+    uart_tx_level();
+
+    /* enable UDRE interrupt */
+    UART0_CONTROL |= _BV(UART0_UDRIE);
+}/* uart_tx_commit */
+
+/*************************************************************************
+ * Function: uart_write()
+ * Purpose:  write block of bytes to ringbuffer for transmitting via UART
+ * Input:    data and number of bytes
+ * Returns:  none
+ **************************************************************************/
+void uart_write(const void *data, unsigned int size)
+{
+    uart_write_policy(data, size, UART_TX_BLOCK);
+}/* uart_write */
+
+/*************************************************************************
+ * Function: uart_write_policy()
+ * Purpose:  write block of bytes to ringbuffer, full buffer handled by policy
+ * Input:    data, number of bytes, UART_TX_BLOCK, UART_TX_DROP or UART_TX_OVERWRITE
+ * Returns:  number of bytes queued
+ **************************************************************************/
+unsigned int uart_write_policy(const void *data, unsigned int size, unsigned char policy)
+{
+    const unsigned char *src = data;
+    unsigned int queued = 0;
+    unsigned char *span;
+    unsigned char count;
+
+
+    if (policy & UART_TX_OVERWRITE)
+    {
+        /* only the newest bytes fit into the buffer */
+        if (size > UART_TX_BUFFER_SIZE - 1)
+        {
+            uart_tx_drop(size - (UART_TX_BUFFER_SIZE - 1));
+            src += size - (UART_TX_BUFFER_SIZE - 1);
+            size = UART_TX_BUFFER_SIZE - 1;
+        }
+        uart_tx_discard(size);
+    }
+    while (size)
+    {
+        /* one copy per contiguous span, two if buffer wraps around */
+        count = uart_tx_reserve(0, &span);
+        if (count == 0)
+        {
+            if (policy == UART_TX_BLOCK)
+            {
+                continue; /* wait for free space in buffer */
+            }
+            uart_tx_drop(size);
+            break;
+        }
+        if (count > size)
+        {
+            count = size;
+        }
+        memcpy(span, src, count);
+        uart_tx_commit(count);
+        src    += count;
+        size   -= count;
+        queued += count;
+    }
+    return queued;
+}/* uart_write_policy */
+
+/*************************************************************************
+ * Function: uart_tx_room()
+ * Purpose:  make room in transmit ringbuffer for a record
+ * Input:    bytes needed, UART_TX_BLOCK, UART_TX_DROP or UART_TX_OVERWRITE
+ * Returns:  1 if room is available, 0 if record is dropped
+ **************************************************************************/
+unsigned char uart_tx_room(unsigned char size, unsigned char policy)
+{
+    if (size > UART_TX_BUFFER_SIZE - 1)
+    {
+        uart_tx_drop(size); /* never fits */
+        return 0;
+    }
+    if (policy & UART_TX_OVERWRITE)
+    {
+        uart_tx_discard(size);
+    }
+    while (((UART_TxTail - UART_TxHead - 1) & UART_TX_BUFFER_MASK) < size)
+    {
+        if (policy != UART_TX_BLOCK)
+        {
+            uart_tx_drop(size);
+            return 0;
+        }
+    }
+    return 1;
+}/* uart_tx_room */
+
+/*************************************************************************
+ * Function: uart_tx_dropped()
+ * Purpose:  number of bytes dropped or discarded by TX policies
+ * Returns:  bytes, saturated at 0xFFFF
+ **************************************************************************/
+unsigned int uart_tx_dropped(void)
+{
+    return UART_TxDropped;
+}/* uart_tx_dropped */
+
+/*************************************************************************
+ * Function: uart_tx_high_water()
+ * Purpose:  highest number of bytes waiting in transmit ringbuffer
+ * Returns:  bytes
+ **************************************************************************/
+unsigned char uart_tx_high_water(void)
+{
+    return UART_TxHighWater;
+}/* uart_tx_high_water */
+
+/*************************************************************************
+ * Function: uart_tx_stats_clear()
+ * Purpose:  clear dropped bytes and high-water counters
+ * Returns:  none
+ **************************************************************************/
+void uart_tx_stats_clear(void)
+{
+    UART_TxDropped = 0;
+    UART_TxHighWater = 0;
+}/* uart_tx_stats_clear */
+
+/*************************************************************************
+ * Function: uart_tx_span()
+ * Purpose:  queue span of RAM or flash for transmitting via UART
+ * Input:    span, number of bytes, UART_TX_RAM or UART_TX_FLASH | policy
+ * Returns:  1 if queued, 0 if dropped
+ **************************************************************************/
+unsigned char uart_tx_span(const void *data, unsigned int size, unsigned char flags)
+{
+    unsigned char tmphead;
+
+
+    if (size == 0)
+    {
+        return 1;
+    }
+    tmphead = (UART_TxSpanHead + 1) & UART_TX_SPANS_MASK;
+
+    while (tmphead == UART_TxSpanTail)
+    {
+        if (flags & (UART_TX_DROP | UART_TX_OVERWRITE))
+        {
+            uart_tx_drop(size);
+            return 0;
+        }
+        /* wait for free descriptor */
+    }
+
+    UART_TxSpan[UART_TxSpanHead].data  = data;
+    UART_TxSpan[UART_TxSpanHead].size  = size;
+    UART_TxSpan[UART_TxSpanHead].flags = flags;
+    UART_TxSpan[UART_TxSpanHead].mark  = UART_TxHead;
+    UART_TxSpanHead = tmphead;
+
+    /* enable UDRE interrupt */
+    UART0_CONTROL |= _BV(UART0_UDRIE);
+    return 1;
+}/* uart_tx_span */
+
+/*************************************************************************
+ * Function: uart_tx_busy()
+ * Purpose:  test for bytes or spans waiting for transmission
+ * Returns:  0 if all was passed to UART
+ **************************************************************************/
+unsigned char uart_tx_busy(void)
+{
+    return (UART_TxHead != UART_TxTail) || (UART_TxSpanHead != UART_TxSpanTail);
+}/* uart_tx_busy */
+
 /*************************************************************************
  * Function: uart_puts()
  * Purpose:  transmit string to UART
@@ -550,8 +884,7 @@ void uart_putc(unsigned char data)
  **************************************************************************/
 void uart_puts(const char *s)
 {
-    while (*s)
-        uart_putc(*s++);
+    uart_write(s, strlen(s));
 }/* uart_puts */
 
 /*************************************************************************
@@ -562,10 +895,7 @@ void uart_puts(const char *s)
  **************************************************************************/
 void uart_puts_p(const char *progmem_s)
 {
-    register char c;
-
-    while ( (c = pgm_read_byte(progmem_s++)) )
-        uart_putc(c);
+    uart_tx_span(progmem_s, strlen_P(progmem_s), UART_TX_FLASH);
 }/* uart_puts_p */
 
 /*
@@ -75,6 +75,65 @@
  */
 #define UART_BAUD_SELECT_DOUBLE_SPEED(baudRate, xtalCpu) ( ((((xtalCpu) + 4UL * (baudRate)) / (8UL * (baudRate)) - 1UL)) | 0x8000)
 
+/** @brief  Largest accepted baudrate error of uart_init_baud() in per mille
+ *
+ *  The datasheet recommends at most 2 % for 8 data bits, 2.5 % still
+ *  accepts 115200 Bd at 16 MHz, which works with USB bridges clocked by
+ *  the same crystal frequency. Can be overridden by adding
+ *  -DUART_BAUD_TOLERANCE=nn to the compiler flags.
+ */
+#ifndef UART_BAUD_TOLERANCE
+#define UART_BAUD_TOLERANCE 25
+#endif
+
+/** @brief  Baudrate error of divisor in per mille
+ *  @param  baudRate baudrate in bps
+ *  @param  xtalCpu  system clock in Hz
+ *  @param  samples  16 for normal speed, 8 for double speed
+ */
+#define UART_BAUD_ERROR(baudRate, xtalCpu, samples) \
+    (UART_BAUD_UBRR(baudRate, xtalCpu, samples) > 4095UL ? 1000UL : \
+     UART_BAUD_DIFF((xtalCpu) / ((samples) * (UART_BAUD_UBRR(baudRate, xtalCpu, samples) + 1UL)), \
+                    (baudRate)) * 1000UL / (baudRate))
+
+/** @brief  UART Baudrate Expression choosing normal or double speed
+ *
+ *  Double speed is used only when its error is smaller, normal speed
+ *  samples each bit more often and tolerates more clock error.
+ *
+ *  @param  baudRate baudrate in bps, e.g. 115200, 250000, 500000, 1000000
+ *  @param  xtalCpu  system clock in Hz, e.g. 16000000UL
+ */
+#define UART_BAUD_SELECT_AUTO(baudRate, xtalCpu) \
+    (UART_BAUD_ERROR(baudRate, xtalCpu, 8UL) < UART_BAUD_ERROR(baudRate, xtalCpu, 16UL) ? \
+     UART_BAUD_SELECT_DOUBLE_SPEED(baudRate, xtalCpu) : UART_BAUD_SELECT(baudRate, xtalCpu))
+
+/** @brief  Baudrate error in per mille of UART_BAUD_SELECT_AUTO() */
+#define UART_BAUD_ERROR_AUTO(baudRate, xtalCpu) \
+    (UART_BAUD_ERROR(baudRate, xtalCpu, 8UL) < UART_BAUD_ERROR(baudRate, xtalCpu, 16UL) ? \
+     UART_BAUD_ERROR(baudRate, xtalCpu, 8UL) : UART_BAUD_ERROR(baudRate, xtalCpu, 16UL))
+
+/** @brief  Initialize UART to a constant baudrate at F_CPU
+ *
+ *  Picks normal or double speed by UART_BAUD_SELECT_AUTO(). Compilation
+ *  fails when the baudrate cannot be reached within UART_BAUD_TOLERANCE,
+ *  e.g. 115200 Bd at 16 MHz uses double speed (2.1 % instead of 3.5 %),
+ *  250000, 500000 and 1000000 Bd are exact.
+ *
+ *  @param  baudRate constant baudrate in bps
+ */
+#define uart_init_baud(baudRate) \
+    do { \
+        _Static_assert(UART_BAUD_ERROR_AUTO(baudRate, F_CPU) <= UART_BAUD_TOLERANCE, \
+                       "UART baudrate error too large at F_CPU"); \
+        uart_init(UART_BAUD_SELECT_AUTO(baudRate, F_CPU)); \
+    } while (0)
+
+/* helpers of UART_BAUD_ERROR() */
+#define UART_BAUD_UBRR(baudRate, xtalCpu, samples) \
+    (((xtalCpu) + (samples) / 2UL * (baudRate)) / ((samples) * (baudRate)) - 1UL)
+#define UART_BAUD_DIFF(a, b) ((a) > (b) ? (a) - (b) : (b) - (a))
+
 /** @brief  Size of the circular receive buffer, must be power of 2
  *
  *  You may need to adapt this constant to your target and your application by adding
@@ -93,6 +152,34 @@
 # define UART_TX_BUFFER_SIZE 128
 #endif
 
+/*
+ *  UART_RX_HOOK: function called by the receive interrupt after every byte.
+ *  Not defined by default. Add CDEFS += -DUART_RX_HOOK=function to your
+ *  Makefile to get receive timing, e.g. for frame gaps of Modbus RTU.
+ *  The function runs in interrupt context and must be short.
+ */
+
+/** @brief  Number of transmit span descriptors, must be power of 2
+ *
+ *  One descriptor is always kept free, so SIZE-1 spans can be queued
+ *  by uart_tx_span().
+ */
+#ifndef UART_TX_SPANS
+# define UART_TX_SPANS 4
+#endif
+
+/** @brief  Flag of uart_tx_span(): span is in RAM */
+#define UART_TX_RAM   0x00
+/** @brief  Flag of uart_tx_span(): span is in program memory */
+#define UART_TX_FLASH 0x01
+
+/** @brief  TX policy: wait for free space when transmit buffer is full */
+#define UART_TX_BLOCK     0x00
+/** @brief  TX policy: drop the new bytes which do not fit */
+#define UART_TX_DROP      0x02
+/** @brief  TX policy: discard the oldest queued bytes to make room */
+#define UART_TX_OVERWRITE 0x04
+
 /* test if the size of the circular buffers fits into SRAM */
 #if ( (UART_RX_BUFFER_SIZE + UART_TX_BUFFER_SIZE) >= (RAMEND - 0x60 ) )
 # error "size of UART_RX_BUFFER_SIZE + UART_TX_BUFFER_SIZE larger than size of SRAM"
@@ -114,7 +201,9 @@
 
 /**
  * @brief   Initialize UART and set baudrate
- * @param   baudrate Specify baudrate using macro UART_BAUD_SELECT()
+ * @param   baudrate Specify baudrate using macro UART_BAUD_SELECT(),
+ *          UART_BAUD_SELECT_DOUBLE_SPEED() or UART_BAUD_SELECT_AUTO(),
+ *          see also uart_init_baud()
  * @return  none
  */
 extern void uart_init(unsigned int baudrate);
@@ -155,6 +244,127 @@ extern unsigned int uart_getc(void);
 extern void uart_putc(unsigned char data);
 
 
+/**
+ *  @brief   Put block of bytes to ringbuffer for transmitting via UART
+ *
+ *  Bytes are copied by one memcpy per contiguous free span of the
+ *  circular buffer. Blocks until all bytes are in the buffer.
+ *
+ *  @param   data bytes to be transmitted
+ *  @param   size number of bytes
+ *  @return  none
+ */
+extern void uart_write(const void *data, unsigned int size);
+
+
+/**
+ *  @brief   Put block of bytes to ringbuffer, full buffer handled by policy
+ *
+ *  - \b UART_TX_BLOCK waits like uart_write()
+ *  - \b UART_TX_DROP queues what fits and drops the rest
+ *  - \b UART_TX_OVERWRITE discards the oldest bytes not yet sent (never
+ *    bytes queued before a pending uart_tx_span()), a block longer than
+ *    the buffer keeps its last bytes
+ *
+ *  Dropped and discarded bytes are counted, see uart_tx_dropped().
+ *
+ *  @param   data bytes to be transmitted
+ *  @param   size number of bytes
+ *  @param   policy \b UART_TX_BLOCK, \b UART_TX_DROP or \b UART_TX_OVERWRITE
+ *  @return  number of bytes queued
+ */
+extern unsigned int uart_write_policy(const void *data, unsigned int size, unsigned char policy);
+
+
+/**
+ *  @brief   Make room for a record written by uart_tx_reserve()
+ *
+ *  With \b UART_TX_BLOCK waits for free space, with \b UART_TX_OVERWRITE
+ *  discards oldest bytes. Without enough room the record counts as
+ *  dropped.
+ *
+ *  @param   size bytes needed
+ *  @param   policy \b UART_TX_BLOCK, \b UART_TX_DROP or \b UART_TX_OVERWRITE
+ *  @return  1 if size bytes can be reserved, 0 if record has to be dropped
+ */
+extern unsigned char uart_tx_room(unsigned char size, unsigned char policy);
+
+
+/**
+ *  @brief   Number of bytes dropped or discarded by TX policies
+ *
+ *  @return  bytes since uart_init() or uart_tx_stats_clear(), saturates at 0xFFFF
+ */
+extern unsigned int uart_tx_dropped(void);
+
+
+/**
+ *  @brief   Highest number of bytes waiting in transmit ringbuffer
+ *
+ *  @return  bytes since uart_init() or uart_tx_stats_clear()
+ */
+extern unsigned char uart_tx_high_water(void);
+
+
+/**
+ *  @brief   Clear dropped bytes and high-water counters
+ *  @return  none
+ */
+extern void uart_tx_stats_clear(void);
+
+
+/**
+ *  @brief   Reserve free space of transmit ringbuffer for writing in place
+ *
+ *  Returns the contiguous free span starting \p offset bytes behind the
+ *  bytes already committed. Call with offset 0 for the first span and with
+ *  the size of the first span to get the second span where the buffer
+ *  wraps around. Nothing is transmitted until uart_tx_commit().
+ *  Does not block.
+ *
+ *  @param   offset bytes of reservation already used
+ *  @param   span returns pointer to first byte of span
+ *  @return  number of bytes of span, 0 if there is no free space at offset
+ *  @see     uart_tx_commit
+ */
+extern unsigned char uart_tx_reserve(unsigned char offset, unsigned char **span);
+
+
+/**
+ *  @brief   Transmit bytes written into spans of uart_tx_reserve()
+ *
+ *  @param   count number of bytes written, at most the reserved size
+ *  @return  none
+ */
+extern void uart_tx_commit(unsigned char count);
+
+
+/**
+ *  @brief   Queue span of RAM or program memory for transmitting via UART
+ *
+ *  The UDRE interrupt sends the span directly from its memory after the
+ *  bytes already in the ringbuffer, no bytes are copied and no ringbuffer
+ *  space is used. Bytes put into the ringbuffer later are sent after the
+ *  span. A RAM span must not change until it is sent, see uart_tx_busy().
+ *  Blocks while all descriptors are in use, with \b UART_TX_DROP or
+ *  \b UART_TX_OVERWRITE in flags the span is dropped instead.
+ *
+ *  @param   data first byte of span
+ *  @param   size number of bytes
+ *  @param   flags \b UART_TX_RAM or \b UART_TX_FLASH, optionally or-ed with TX policy
+ *  @return  1 if span is queued, 0 if dropped
+ */
+extern unsigned char uart_tx_span(const void *data, unsigned int size, unsigned char flags);
+
+
+/**
+ *  @brief   Test for bytes or spans waiting for transmission
+ *
+ *  @return  0 if everything queued was passed to the UART
+ */
+extern unsigned char uart_tx_busy(void);
+
+
 /**
  *  @brief   Put string to ringbuffer for transmitting via UART
  *
@@ -169,11 +379,11 @@ extern void uart_puts(const char *s);
 
 
 /**
- * @brief    Put string from program memory to ringbuffer for transmitting via UART.
+ * @brief    Queue string from program memory for transmitting via UART.
  *
- * The string is buffered by the uart library in a circular buffer
- * and one character at a time is transmitted to the UART using interrupts.
- * Blocks if it can not write the whole string into the circular buffer.
+ * The string is sent directly from program memory by uart_tx_span(),
+ * it does not use the circular buffer.
+ * Blocks while all span descriptors are in use.
  *
  * @param    s program memory string to be transmitted
  * @return   none
@@ -0,0 +1,106 @@
+/**************************************************************************/
+/*!
+@file     widget.c
+@brief    Retained text widgets on the OLED display buffer
+@license  MIT
+
+Screen is built from static labels and value widgets. A value widget
+remembers its rendered text, so a periodic update with the same value
+costs no buffer writes and no bus transfer. Changed glyphs are drawn into
+the display buffer and marked dirty for oled_display_dirty().
+*/
+/**************************************************************************/
+
+#include "widget.h"
+#include <oled.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#if !defined GRAPHICMODE
+# error "Widgets need the display buffer, set GRAPHICMODE in oled.h"
+#endif
+
+/// Width of NORMALSIZE glyph in pixels, widgets don't use DOUBLESIZE
+#define WIDGET_GLYPH_WIDTH 6
+
+/// True for continuation bytes of UTF-8 sequence
+#define UTF8_CONTINUATION(c) (((uint8_t)(c) & 0xC0) == 0x80)
+
+/**************************************************************************/
+/*!
+@brief  Count glyphs of UTF-8 text
+
+@param[in] text  Zero-terminated text
+
+@return Number of glyphs
+*/
+/**************************************************************************/
+
+static uint8_t widget_glyphs(const char *text)
+{
+    uint8_t count = 0;
+
+    for (; *text != 0; text++) {
+        if (!UTF8_CONTINUATION(*text)) count++;
+    }
+    return count;
+}
+
+void widget_label(uint8_t x, uint8_t line, PGM_P text)
+{
+    uint8_t glyphs = 0;
+    char c;
+
+    oled_goto_xpix_y(x, line);
+    while ((c = pgm_read_byte(text++)) != 0) {
+        oled_putc(c);
+        if (!UTF8_CONTINUATION(c)) glyphs++;
+    }
+    oled_mark_dirty(x, line, glyphs * WIDGET_GLYPH_WIDTH);
+}
+
+void widget_init(widget_t *widget, uint8_t x, uint8_t line, PGM_P format)
+{
+    widget->x = x;
+    widget->line = line;
+    widget->format = format;
+    widget->text[0] = 0;
+}
+
+uint8_t widget_printf(widget_t *widget, ...)
+{
+    char text[WIDGET_TEXT_SIZE];
+    va_list args;
+    uint8_t start = 0;      // first byte of first changed glyph
+    uint8_t glyphs = 0;     // unchanged glyphs before start
+    uint8_t i, newGlyphs, oldGlyphs;
+
+    va_start(args, widget);
+    vsnprintf_P(text, sizeof(text), widget->format, args);
+    va_end(args);
+
+    // skip common prefix, start stays on the first byte of a glyph
+    for (i = 0; text[i] != 0 && text[i] == widget->text[i]; i++) {
+        if (!UTF8_CONTINUATION(text[i+1])) {
+            start = i + 1;
+            glyphs++;
+        }
+    }
+    if (text[i] == widget->text[i]) return 0;  // both texts ended
+
+    newGlyphs = widget_glyphs(&text[start]);
+    oldGlyphs = widget_glyphs(&widget->text[start]);
+
+    uint8_t x = widget->x + glyphs * WIDGET_GLYPH_WIDTH;
+    oled_goto_xpix_y(x, widget->line);
+    oled_puts(&text[start]);
+    for (i = newGlyphs; i < oldGlyphs; i++) {
+        oled_putc(' ');     // clear rest of longer old text
+    }
+    oled_mark_dirty(x, widget->line,
+                    ((newGlyphs > oldGlyphs) ? newGlyphs : oldGlyphs) * WIDGET_GLYPH_WIDTH);
+
+    memcpy(widget->text, text, sizeof(text));
+    return 1;
+}
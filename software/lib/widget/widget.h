@@ -0,0 +1,82 @@
+/**************************************************************************/
+/*!
+@file     widget.h
+@brief    Header for retained text widgets on the OLED display buffer
+*/
+/**************************************************************************/
+
+#ifndef WIDGET_H
+#define WIDGET_H
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+/// Size of formatted text of a value widget including terminating zero
+#ifndef WIDGET_TEXT_SIZE
+#define WIDGET_TEXT_SIZE 16
+#endif
+
+/**************************************************************************/
+/*!
+@brief  Value widget state
+
+Keeps the text rendered last time, a new value redraws only the glyphs
+from the first changed one and marks only their columns dirty.
+*/
+/**************************************************************************/
+
+typedef struct {
+    uint8_t x;              /*!< Left column in pixels */
+    uint8_t line;           /*!< Display line (page) */
+    PGM_P format;           /*!< printf format string in flash */
+    char text[WIDGET_TEXT_SIZE]; /*!< Text rendered last time (UTF-8) */
+} widget_t;
+
+/**************************************************************************/
+/*!
+@brief  Draw static label into the display buffer
+
+Labels are not retained, they are drawn once and marked dirty.
+
+@param[in] x     Left column in pixels (0–127)
+@param[in] line  Display line (0–7)
+@param[in] text  Label text in flash (UTF-8)
+
+@return None
+*/
+/**************************************************************************/
+
+void widget_label(uint8_t x, uint8_t line, PGM_P text);
+
+/**************************************************************************/
+/*!
+@brief  Initialize value widget, nothing is drawn until first value
+
+@param[in] widget  Widget state
+@param[in] x       Left column in pixels (0–127)
+@param[in] line    Display line (0–7)
+@param[in] format  printf format string in flash, e.g. PSTR("%4.1f °C")
+
+@return None
+*/
+/**************************************************************************/
+
+void widget_init(widget_t *widget, uint8_t x, uint8_t line, PGM_P format);
+
+/**************************************************************************/
+/*!
+@brief  Format new value and redraw the changed part of the widget
+
+Text longer than WIDGET_TEXT_SIZE-1 bytes is cut. Glyphs left over from
+a longer old text are cleared.
+
+@param[in] widget  Widget state
+@param[in] ...     Arguments of the widget format
+
+@return 1 if display buffer changed, 0 if text is the same
+*/
+/**************************************************************************/
+
+uint8_t widget_printf(widget_t *widget, ...);
+
+#endif
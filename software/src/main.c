@@ -7,10 +7,21 @@
 #include "adc.h"            // Simple ADC driver for AVR (single-ended, 10-bit)
 #include "mq135.h"          // Gas concentration sensor library
 #include <twi.h>            // I2C/TWI library for AVR-GCC
-#include <stdio.h>          // C library. Needed for `sprintf`
 #include <oled.h>           // OLED display commands
+#include "chart.h"          // Trend charts on OLED display buffer
+#include "widget.h"         // Retained text widgets on OLED display buffer
+#include "telemetry.h"      // Binary telemetry records over UART
+#include "shell.h"          // Command shell over UART
+#include "modbus.h"         // Modbus RTU slave over UART
+#include "filter.h"         // Outlier rejection and smoothing of ADC codes
+#include "stats.h"          // Window statistics of samples
+#include "history.h"        // History of minute means in SRAM
+#include "logger.h"         // Hourly aggregates in EEPROM
+#include "transfer.h"       // Bulk transfer of history and log
 #include "gpio.h"           // GPIO library for AVR-GCC
 #include <util/delay.h>     // Functions for busy-wait delay loops
+#include <string.h>         // C library. Needed for `strcmp_P` and `memcpy`
+#include <stdio.h>          // C library. Needed for `snprintf_P`
 
 #define DHT_ADR 0x5c //I2C adress of DHT12 sensor
 //Register adresses of humidity and temperature registers
@@ -18,15 +29,355 @@
 #define DHT_TEMP_MEM 2
 
 #define MQ 0
-#define MQ_D PD2
+#define MQ_D PD2 //CO2 alert output of MQ-135 module (active low), INT0
+#define MQ_D_IO D, MQ_D
+
+//Dust samples (dust_us each) with INT0 off after an accepted alert edge
+#define ALERT_LOCKOUT 5
+
+#define UART_BAUD 500000 //Exact at 16 MHz, fits full-rate telemetry
+
+//Modbus RTU slave address at boot, 0 starts with command shell and telemetry
+#ifndef MODBUS_ADDRESS
+#define MODBUS_ADDRESS 0
+#endif
 
 #define GP_LED_PIN  PB0
+#define GP_LED_IO   B, GP_LED_PIN //Compile-time pin of dust sensor LED for ISR
 #define GP_ADC_CH   1 
 
 volatile uint8_t flag_update_uart = 0; //Signal flag used to trigger update of displayed values
 volatile uint16_t GP_read = 0; 
+volatile uint32_t GP_time = 0;          //Timestamp of GP_read in timer 1 ticks (16 us)
+volatile uint8_t flag_dust_sample = 0;  //New GP_read for telemetry
+volatile uint8_t flag_dust_overrun = 0; //GP_read overwritten before it was sent
+volatile uint32_t tim1_overflows = 0;   //Timer 1 overflows (1.048576 s), low 16 bits are upper bits of timestamp
+volatile uint8_t dust_reload = 118;     //TCNT2 after LED pulse, sets dust sample period
+volatile uint8_t alert_active = 0;      //Debounced CO2 alert output of MQ-135 module
+volatile uint8_t flag_alert = 0;        //alert_active changed, display not updated yet
+volatile uint32_t alert_time = 0;       //Timestamp of change in timer 1 ticks (16 us)
+volatile uint8_t alert_lockout = 0;     //Dust samples until INT0 is enabled again
+
+//Parameters tuned by the command shell
+static uint16_t dust_period = 9088;     //Dust sample period in us (timer 2 ticks of 64 us)
+static float dust_offset = 0.1f;        //Dust sensor output in clean air (V)
+static float dust_sensitivity = 5.8f;   //Dust sensor sensitivity (V per mg/m3)
+static uint16_t i2c_khz = F_SCL / 1000; //I2C clock (kHz)
+static uint8_t contrast = 0x3F;         //Display contrast, as set by oled_init()
+static uint8_t invert = 0;              //Inverted display
+static uint8_t telemetry_on = 1;        //Send telemetry records
+static uint8_t modbus_address = MODBUS_ADDRESS; //Modbus slave address, 0 for shell
+
+//Last measurement, used by calibration
+static float temp = 0.0;
+static float hum = 0.0;
+static float rs = 0.0;
+static float GP_U = 0.0;
+
+//Filters of raw ADC codes before conversion, Hampel drops single spikes
+static filter_hampel_t filter_CO2;      //Heater transients of MQ-135, once per second
+static filter_hampel_t filter_dust;     //Spikes of dust sensor, every dust sample
+static filter_ema_t ema_dust;           //Smoothing of dust samples
+static int16_t dust_code = 0;           //Filtered dust ADC code
+
+//Sources of bulk transfer (dump command)
+#define DUMP_HISTORY 0
+#define DUMP_LOG 1
+
+//History dump of shell commands, shared by history and dump
+static history_iter_t history_iter;
+static uint8_t dump_drops;  //Dropped history blocks at start of dump
+
+//Counters reported by stats command
+static uint16_t telemetry_dropped = 0;
+static uint16_t dust_overruns = 0;
+static uint16_t alert_events = 0;
+static uint16_t alert_latency = 0;      //Alert edge to inverted display, last and worst (16 us ticks)
+static uint16_t alert_latency_max = 0;
+
+//Telemetry record, computed values are updated once per second
+static telemetry_sample_t sample;
+
+//Trend of last 60 values of CO2 and dust on bottom lines of display
+static chart_t chart_CO2;
+static chart_t chart_dust;
+
+//Displayed values, redrawn only when their text changes
+static widget_t widget_temp;
+static widget_t widget_hum;
+static widget_t widget_CO2;
+static widget_t widget_dust;
+static widget_t widget_alert;
+
+// -- Command shell ----------------------------------------
+static void dust_period_changed(void)
+{
+    //LED pulse takes 4 ticks, the rest of the period is counted from dust_reload
+    dust_reload = 256 - (dust_period / 64 - 4);
+}
+
+static void i2c_changed(void)
+{
+    TWBR = (F_CPU / 1000 / i2c_khz - 16) / 2;
+}
+
+static void contrast_changed(void)
+{
+    oled_set_contrast(contrast);
+}
+
+static void invert_changed(void)
+{
+    //Active CO2 alert shows the display the other way round
+    oled_invert(invert ^ alert_active);
+}
+
+static void modbus_changed(void)
+{
+    //UART belongs to Modbus while address is set, telemetry, shell and dump pause
+    transfer_stop();
+    modbus_enable(modbus_address);
+}
+
+static const shell_param_t shell_params[] PROGMEM = {
+    {"rzero",     SHELL_FLOAT, &RZERO,            1000, 1000000, NULL},
+    {"dust_off",  SHELL_FLOAT, &dust_offset,      0, 5, NULL},
+    {"dust_sens", SHELL_FLOAT, &dust_sensitivity, 0.1, 100, NULL},
+    {"dust_us",   SHELL_U16,   &dust_period,      1000, 16000, dust_period_changed},
+    {"i2c_khz",   SHELL_U16,   &i2c_khz,          32, 400, i2c_changed},
+    {"contrast",  SHELL_U8,    &contrast,         0, 255, contrast_changed},
+    {"invert",    SHELL_U8,    &invert,           0, 1, invert_changed},
+    {"telemetry", SHELL_U8,    &telemetry_on,     0, 1, NULL},
+    {"modbus",    SHELL_U8,    &modbus_address,   0, 247, modbus_changed},
+    {"co2_k",     SHELL_U8,    &filter_CO2.k,     0, 10, NULL},
+    {"dust_k",    SHELL_U8,    &filter_dust.k,    0, 10, NULL},
+    {"dust_ema",  SHELL_U8,    &ema_dust.shift,   0, FILTER_EMA_FRAC, NULL},
+};
+
+/**
+ * @brief Calibrate sensor from the last measurement in clean air.
+ * @details `cal co2` sets RZERO for the atmospheric CO2 level, `cal dust` sets the
+ * dust sensor offset voltage.
+ */
+static uint8_t cmd_cal(char *args, uint8_t step)
+{
+    (void)step;
+    if ((sample.flags & TELEMETRY_FLAG_VALUES) == 0) {
+        shell_printf_P(PSTR("no measurement yet"));
+    } else if (strcmp_P(args, PSTR("co2")) == 0) {
+        RZERO = getCorrectedRZero(temp, hum, rs);
+        shell_printf_P(PSTR("rzero = %g"), RZERO);
+    } else if (strcmp_P(args, PSTR("dust")) == 0) {
+        dust_offset = GP_U;
+        shell_printf_P(PSTR("dust_off = %g"), dust_offset);
+    } else {
+        shell_printf_P(PSTR("cal co2|dust"));
+    }
+    return 0;
+}
+
+/**
+ * @brief Print runtime statistics, one line per step.
+ */
+static uint8_t cmd_stats(char *args, uint8_t step)
+{
+    uint32_t overflows;
+
+    (void)args;
+    switch (step) {
+    case 0:
+        cli();
+        overflows = tim1_overflows;
+        sei();
+        //An overflow takes 65536 ticks of 16 us, 1 + 3036/62500 s, without 32-bit overflow
+        shell_printf_P(PSTR("uptime %lu s"),
+                       overflows + overflows / 62500 * 3036 + overflows % 62500 * 3036 / 62500);
+        break;
+    case 1:
+        shell_printf_P(PSTR("uart dropped %u, high water %u"), uart_tx_dropped(), uart_tx_high_water());
+        break;
+    case 2:
+        shell_printf_P(PSTR("telemetry dropped %u, overruns %u"), telemetry_dropped, dust_overruns);
+        break;
+    case 3:
+        shell_printf_P(PSTR("modbus frames %u, errors %u, exceptions %u"), modbus_stats()->frames,
+                       modbus_stats()->errors, modbus_stats()->exceptions);
+        break;
+    case 4:
+        shell_printf_P(PSTR("alerts %u, latency %lu us, max %lu us"), alert_events,
+                       alert_latency * 16UL, alert_latency_max * 16UL);
+        break;
+    default:
+        shell_printf_P(PSTR("rx errors %u"), shell_rx_errors());
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Print stored history as CSV, oldest record first, one line per step.
+ * @details Columns are age in periods, temperature (0.1 °C), humidity (0.1 %),
+ * CO2 (ppm) and dust (0.1 ug/m3).
+ */
+static uint8_t cmd_history(char *args, uint8_t step)
+{
+    (void)args;
+    if (step == 0) {
+        history_iter_init(&history_iter);
+        shell_printf_P(PSTR("age,temp,hum,co2,dust"));
+        return 1;
+    }
+    if (!history_iter_next(&history_iter)) return 0;
+    shell_printf_P(PSTR("%u,%d,%d,%d,%d"), history_count() - 1 - history_iter.index,
+                   history_iter.values[0], history_iter.values[1],
+                   history_iter.values[2], history_iter.values[3]);
+    return 1;
+}
+
+/**
+ * @brief Print EEPROM log as CSV, newest record first, one channel per step.
+ * @details Columns are age in hours, channel (0 temperature, 1 humidity, 2 CO2,
+ * 3 dust, units as history) and minimum, mean and maximum of the hour.
+ */
+static uint8_t cmd_log(char *args, uint8_t step)
+{
+    uint16_t age = (step - 1) / LOGGER_CHANNELS;
+    uint8_t channel = (step - 1) % LOGGER_CHANNELS;
+    int16_t values[3];
+
+    (void)args;
+    if (step == 0) {
+        shell_printf_P(PSTR("age,ch,min,mean,max"));
+        return 1;
+    }
+    if (age >= logger_count()) return 0;
+    if (logger_read(age, channel, values)) {
+        shell_printf_P(PSTR("%u,%u,%d,%d,%d"), age, channel, values[0], values[1], values[2]);
+    } else {
+        shell_printf_P(PSTR("%u,%u,invalid"), age, channel);
+    }
+    return 1;
+}
+
+/**
+ * @brief Read history record for dump, 4 values of 16 bits (little-endian).
+ * @details Restarts the iterator when it is past the record, a dropped block
+ * shifts all records and ends the transfer.
+ */
+static uint8_t dump_history(uint16_t item, uint8_t *data)
+{
+    if (history_iter.index == 0xFFFF || history_iter.index > item) {
+        history_iter_init(&history_iter);
+    }
+    if (history_iter.drops != dump_drops) return 0;
+    while (history_iter.index != item) {
+        if (!history_iter_next(&history_iter)) return 0;
+    }
+    memcpy(data, history_iter.values, sizeof(history_iter.values));
+    return 1;
+}
+
+/**
+ * @brief Read EEPROM log slot for dump, the receiver checks and orders records.
+ */
+static uint8_t dump_log(uint16_t item, uint8_t *data)
+{
+    logger_read_slot(item, (logger_record_t *)data);
+    return 1;
+}
+
+/**
+ * @brief Start bulk transfer of history or EEPROM log, see tools/dump.py.
+ * @details Replies "dump <source> <items> <item size> <blocks>", blocks follow
+ * as binary frames and are acknowledged by ack and nak commands.
+ */
+static uint8_t cmd_dump(char *args, uint8_t step)
+{
+    uint16_t blocks;
+
+    (void)step;
+    if (strcmp_P(args, PSTR("history")) == 0) {
+        history_iter_init(&history_iter);
+        dump_drops = history_iter.drops;
+        blocks = transfer_start(DUMP_HISTORY, dump_history, history_count(), sizeof(history_iter.values));
+        shell_printf_P(PSTR("dump %u %u %u %u"), DUMP_HISTORY, history_count(),
+                       sizeof(history_iter.values), blocks);
+    } else if (strcmp_P(args, PSTR("log")) == 0) {
+        blocks = transfer_start(DUMP_LOG, dump_log, LOGGER_SLOTS, sizeof(logger_record_t));
+        shell_printf_P(PSTR("dump %u %u %u %u"), DUMP_LOG, LOGGER_SLOTS, sizeof(logger_record_t), blocks);
+    } else if (strcmp_P(args, PSTR("stop")) == 0) {
+        transfer_stop();
+    } else {
+        shell_printf_P(PSTR("dump history|log|stop"));
+    }
+    return 0;
+}
+
+/**
+ * @brief Acknowledge dump blocks before the given one, silent while a dump runs.
+ */
+static uint8_t cmd_ack(char *args, uint8_t step)
+{
+    (void)step;
+    if (!transfer_active()) {
+        shell_printf_P(PSTR("no dump"));
+    } else {
+        transfer_ack(strtoul(args, NULL, 10));
+    }
+    return 0;
+}
+
+/**
+ * @brief Send dump blocks again from the given one on, silent while a dump runs.
+ */
+static uint8_t cmd_nak(char *args, uint8_t step)
+{
+    (void)step;
+    if (!transfer_active()) {
+        shell_printf_P(PSTR("no dump"));
+    } else {
+        transfer_nak(strtoul(args, NULL, 10));
+    }
+    return 0;
+}
+
+static const shell_command_t shell_commands[] PROGMEM = {
+    {"cal", cmd_cal},
+    {"stats", cmd_stats},
+    {"history", cmd_history},
+    {"log", cmd_log},
+    {"dump", cmd_dump},
+    {"ack", cmd_ack},
+    {"nak", cmd_nak},
+};
 
 // -- Function definitions ---------------------------------
+/**
+ * @brief Timestamp in timer 1 ticks (16 us), call with interrupts disabled.
+ * @details The overflow of timer 1 may be pending, it is counted when TCNT1 already wrapped.
+ */
+static uint32_t tim1_timestamp(void)
+{
+    uint16_t ticks = TCNT1;
+    uint16_t overflows = tim1_overflows;
+    if ((TIFR1 & (1<<TOV1)) && ticks < 0x8000) overflows++;
+    return ((uint32_t)overflows << 16) | ticks;
+}
+
+/**
+ * @brief Take level of CO2 alert output, called by interrupts.
+ * @return 1 if alert_active changed, then flag_alert is set
+ */
+static uint8_t alert_sample(void)
+{
+    uint8_t active = (GPIO_READ(MQ_D_IO) == 0);
+    if (active == alert_active) return 0;
+    alert_active = active;
+    alert_time = tim1_timestamp();
+    flag_alert = 1;
+    return 1;
+}
+
 /**
  * @brief Main application function for the environmental monitoring system.
  * * @details This function initializes all necessary peripherals (ADC, TWI, UART, OLED, Timers)
@@ -41,16 +392,16 @@ volatile uint16_t GP_read = 0;
 int main(void)
 {
     uint8_t dht12_values[4];
-    float temp = 0.0;
-    float hum = 0.0;
     uint16_t val = 0;
+    stats_t window;
 
-    //Storage of strings containing informations about each parameter (displayed strings)
-    char str_temp[22];
-    char str_hum[22];
-    char str_CO2[20];
-    char str_GP[22];
+    //Timer 1 measures boot time until first frame is on display (4 us per tick)
+    tim1_ovf_262ms();
 
+    logger_init(); //Continue EEPROM log behind its newest record
+    filter_hampel_init(&filter_CO2, 3, 4);  //3 standard deviations, at least 4 LSB
+    filter_hampel_init(&filter_dust, 3, 4);
+    filter_ema_init(&ema_dust, 4);          //Time constant of 16 dust samples
     adc_init(); //Initialization of adc for PM sensor reading
     twi_init(); //Initialization of I2C interface
 
@@ -59,14 +410,47 @@ int main(void)
     
     sei(); // Interrupts enabled
 
-    // Initialize USART to asynchronous, 8-N-1, 115200 Bd
-    uart_init(UART_BAUD_SELECT(115200, F_CPU));
-    //Intialize, clear and set font size of OLED display 
-    oled_init(OLED_DISP_ON);
-    oled_clrscr();
+    // Initialize USART to asynchronous, 8-N-1, UART_BAUD
+    uart_init_baud(UART_BAUD);
+    shell_init(shell_params, sizeof(shell_params) / sizeof(shell_params[0]),
+               shell_commands, sizeof(shell_commands) / sizeof(shell_commands[0]));
+    //Input registers: 0-1 timestamp, 2 ADC CO2, 3 ADC dust, 4-5 DHT12 bytes,
+    //6 temperature, 7 humidity, 8 CO2, 9 dust, 10 flags (see telemetry_sample_t).
+    //Holding registers are the shell parameters in table order.
+    modbus_init(&sample, sizeof(sample), shell_params, sizeof(shell_params) / sizeof(shell_params[0]), UART_BAUD);
+    //First frame (labels and empty charts) is drawn into the display buffer,
+    //oled_init() sends it instead of clearing the display
     oled_charMode(NORMALSIZE);
-    
+    chart_init(&chart_CO2, 0, 6, 60, 2);
+    chart_init(&chart_dust, 66, 6, 60, 2);
+
+    //Static labels and value widgets, columns in pixels (6 per character)
+    widget_label(0, 1, PSTR("Teplota:"));
+    widget_label(0, 2, PSTR("Vlhkost:"));
+    widget_label(0, 3, PSTR("CO2 ="));
+    widget_label(0, 4, PSTR("Dust ="));
+    widget_init(&widget_temp, 54, 1, PSTR("%4.1f °C"));
+    widget_init(&widget_hum, 54, 2, PSTR("%4.1f %%"));
+    widget_init(&widget_CO2, 36, 3, PSTR("%.1f ppm"));
+    widget_init(&widget_dust, 42, 4, PSTR("%4.2f ug/m3"));
+    widget_init(&widget_alert, 0, 5, PSTR("%s"));
+    oled_init(OLED_DISP_ON);
+
+    //Report boot time, timer 1 overflows after 262 ms. No text on a Modbus line
+    if (modbus_address != 0) {
+        modbus_changed();
+    } else if (TIFR1 & (1<<TOV1)) {
+        uart_puts_P("Boot to first frame: > 262 ms\r\n");
+    } else {
+        char str_boot[8];
+        uart_puts_P("Boot to first frame: ");
+        uart_puts(ultoa((uint32_t)TCNT1 * 64 / (F_CPU / 1000000), str_boot, 10));
+        uart_puts_P(" us\r\n");
+    }
+
     //Enable timer 1 overflow and set prescaler for 1s timing
+    TCNT1 = 0;
+    TIFR1 = (1<<TOV1);
     tim1_ovf_1sec();
     tim1_ovf_enable();
  
@@ -74,9 +458,35 @@ int main(void)
     tim2_ovf_16ms();      
     tim2_ovf_enable();   
 
+    //CO2 alert output raises INT0 on any change, display follows without waiting for the next second
+    EICRA = (EICRA & ~((1<<ISC01) | (1<<ISC00))) | (1<<ISC00);
+    EIFR = (1<<INTF0);
+    EIMSK |= (1<<INT0);
+    cli();
+    alert_sample();
+    sei();
+
     // Infinite loop
     while (1)
     {
+        if (flag_alert == 1) //Set by INT0 when the CO2 alert output changed
+        {
+            //Invert whole panel by one command, no frame is sent
+            cli();
+            uint8_t active = alert_active;
+            flag_alert = 0;
+            sei();
+            oled_invert(invert ^ active);
+
+            //Latency from edge to command on the display bus
+            cli();
+            uint32_t latency = tim1_timestamp() - alert_time;
+            sei();
+            alert_latency = (latency < 0xFFFF) ? latency : 0xFFFF;
+            if (alert_latency > alert_latency_max) alert_latency_max = alert_latency;
+            alert_events++;
+        }
+
         if (flag_update_uart == 1) //Trigered by overflow of timer 1 once every second
         {
             //Read data from DHT12 humidity and temperature resgisters over I2C
@@ -84,67 +494,120 @@ int main(void)
             //Covert values from 2 pairs of uint8 into 2 floats (one for temperature and one for humidity)
             temp = dht12_values[2]+0.1*dht12_values[3];
             hum = dht12_values[0]+0.1*dht12_values[1];
+            for (uint8_t i = 0; i < 4; i++) sample.dht12[i] = dht12_values[i];
 
-            /* Read MQ135 ADC value */
+            /* Read MQ135 ADC value, a spike is replaced by the median of the last samples */
             val = adc_read(MQ);
             /* Convert ADC value to voltage (V) */
-            float v_meas = (5 * (float)val) / 1023.0f;  
+            float v_meas = (5 * (float)filter_hampel(&filter_CO2, val)) / 1023.0f;
             /* Calculate sensor resistance in Ohms */
-            float rs = getResistance(5.0f, v_meas); //5V supply
+            rs = getResistance(5.0f, v_meas); //5V supply
             /* Compute CO2 concentration corrected for temperature and humidity */
             float ppm_corr = getCorrectedPPM(temp, hum, rs);
 
-            /* Read dust sensor and convert to voltage */
-            float GP_U = GP_read * (5.0f / 1023.0f);
+            /* Filtered dust sensor code to voltage */
+            GP_U = dust_code * (5.0f / 1023.0f);
             /* Convert voltage to dust concentration (ug/m3) */
-            float dust = 1000*(GP_U-0.1f) /5.8f;
+            float dust = 1000*(GP_U-dust_offset) / dust_sensitivity;
             /* Prevent negative dust values */
             if (dust < 0) dust = 0;
 
-            //Turn all read values into displayable strings (2 commented options used for debug)
-            sprintf(str_temp, "Teplota: %4.1f °C ", temp); 
-            sprintf(str_hum, "Vlhkost: %4.1f %% ", hum);
-            sprintf(str_CO2, "CO2 = %.1f ppm    ", ppm_corr);
-            //sprintf(str_CO2, "V=%.3f  Rs=%.1f  corr=%.1f ", v_meas, rs, ppm_corr); 
-            sprintf(str_GP, "Dust = %4.2f ug/m3   ", dust);
-            //sprintf(str_GP, "U=%5.3f, dust %4.2f", GP_U, dust);
-
-            //Display warning for high CO2 level on screen (warning level set by trimmer on MQ sensor)
-            if( gpio_read(&PIND, MQ_D)==0)
-            {
-                oled_gotoxy(0, 5);
-                oled_puts("CO2 ALERT!");
+            /* Computed values of telemetry in fixed point */
+            sample.adcCO2 = val;
+            sample.temperature = dht12_values[2]*10 + dht12_values[3];
+            sample.humidity = dht12_values[0]*10 + dht12_values[1];
+            sample.co2 = (ppm_corr < 65535.0f) ? (uint16_t)ppm_corr : 65535;
+            sample.dust = (dust < 6553.5f) ? (uint16_t)(dust*10) : 65535;
+            sample.flags = TELEMETRY_FLAG_VALUES | (alert_active ? TELEMETRY_FLAG_ALERT : 0);
+
+            /* Window statistics, minute means for history, hourly aggregates for EEPROM log */
+            int16_t values[STATS_CHANNELS] = {
+                sample.temperature, sample.humidity,
+                (sample.co2 < 32767) ? sample.co2 : 32767,
+                (sample.dust < 32767) ? sample.dust : 32767,
+            };
+            uint8_t done = stats_add(values);
+            if (done & (1 << STATS_1MIN)) {
+                for (uint8_t i = 0; i < STATS_CHANNELS; i++) {
+                    stats_get(STATS_1MIN, i, &window);
+                    values[i] = window.mean;
+                }
+                history_add(values);
+            }
+            if (done & (1 << STATS_1H)) {
+                int16_t min[STATS_CHANNELS], max[STATS_CHANNELS];
+                for (uint8_t i = 0; i < STATS_CHANNELS; i++) {
+                    stats_get(STATS_1H, i, &window);
+                    min[i] = window.min;
+                    values[i] = window.mean;
+                    max[i] = window.max;
+                }
+                logger_add(min, values, max);
             }
-            else
-            {
-                oled_gotoxy(0, 5);
-                oled_puts("           ");//clear only warning line of display
+            for (uint8_t level = 0; level < STATS_LEVELS; level++) {
+                if ((done & (1 << level)) && telemetry_on && modbus_address == 0
+                    && !telemetry_send_stats(level, UART_TX_DROP)) {
+                    telemetry_dropped++;
+                }
+            }
+
+            /* Add values to trend charts, limited to chart sample range */
+            chart_push(&chart_CO2, (ppm_corr < 32767.0f) ? (int16_t)ppm_corr : 32767);
+            chart_push(&chart_dust, (dust < 32767.0f) ? (int16_t)dust : 32767);
+
+            //Update displayed values, unchanged text costs no redraw
+            widget_printf(&widget_temp, temp);
+            widget_printf(&widget_hum, hum);
+            widget_printf(&widget_CO2, ppm_corr);
+            widget_printf(&widget_dust, dust);
+
+            //Display warning for high CO2 level on screen (warning level set by trimmer on MQ sensor),
+            //otherwise mean and standard deviation of CO2 in the actual 15 minute window
+            if (alert_active) {
+                widget_printf(&widget_alert, "CO2 ALERT!");
+            } else if (stats_get(STATS_15MIN, 2, &window) != 0) {
+                char str_stats[WIDGET_TEXT_SIZE];
+                snprintf_P(str_stats, sizeof(str_stats), PSTR("15m %d sd %u"), window.mean, window.std);
+                widget_printf(&widget_alert, str_stats);
+            } else {
+                widget_printf(&widget_alert, "");
             }
 
-            //Printing all values over UART used only for debuging
-            //uart_puts(str_temp);
-            //uart_puts(str_hum);
-            /*
-            uart_puts(str_CO2);
-            uart_puts("\r\n");
-            uart_puts(str_GP);
-            uart_puts("\r\n");
-            uart_puts("\r\n"); */
-
-            //Print all value strings on separate lines and display
-            oled_gotoxy(0, 1);
-            oled_puts(str_temp);
-            oled_gotoxy(0, 2);
-            oled_puts(str_hum);
-            oled_gotoxy(0, 3);
-            oled_puts(str_CO2);
-            oled_gotoxy(0, 4);
-            oled_puts(str_GP);
-            oled_display();
+            //Send only changed columns of display buffer
+            oled_display_dirty();
 
             // Do not print it again and wait for the new data
             flag_update_uart = 0;
         }
+
+        if (flag_dust_sample == 1) //Set by timer 2 after each dust sensor pulse
+        {
+            //Send record with raw dust sample and last computed values
+            cli();
+            sample.adcDust = GP_read;
+            sample.timestamp = GP_time;
+            if (flag_dust_overrun) {
+                sample.flags |= TELEMETRY_FLAG_OVERRUN;
+                dust_overruns++;
+            }
+            flag_dust_sample = 0;
+            flag_dust_overrun = 0;
+            sei();
+            dust_code = filter_ema(&ema_dust, filter_hampel(&filter_dust, sample.adcDust));
+            //Never wait for the UART, a full ring drops the record
+            if (telemetry_on && modbus_address == 0 && !telemetry_send(&sample, UART_TX_DROP)) {
+                telemetry_dropped++;
+            }
+            sample.flags &= ~TELEMETRY_FLAG_OVERRUN;
+        }
+
+        //Requests from UART, Modbus or commands with at most one reply line per pass
+        if (modbus_address != 0) {
+            modbus_poll();
+        } else {
+            shell_poll();       // commands first, ack and nak keep blocks going
+            transfer_poll();
+        }
     }
 
     // Will never reach this
@@ -153,6 +616,21 @@ int main(void)
 
 
 // -- Interrupt service routines ---------------------------
+/**
+ * @brief External Interrupt 0 Service Routine for the CO2 alert output of MQ-135 (PD2).
+ * @details The first edge is taken at once, further edges of the comparator are ignored
+ * for ALERT_LOCKOUT dust samples. Timer 2 enables INT0 again and takes a level that
+ * changed in the meantime.
+ * @param void
+ * @return void
+ */
+ISR(INT0_vect)
+{
+    alert_sample();
+    EIMSK &= ~(1<<INT0);
+    alert_lockout = ALERT_LOCKOUT;
+}
+
 /**
  * @brief Timer/Counter1 Overflow Interrupt Service Routine.
  * * @details This ISR is triggered every 1 second (configured by tim1_ovf_1sec()).
@@ -164,6 +642,7 @@ int main(void)
 ISR(TIMER1_OVF_vect)
 {
     flag_update_uart = 1; 
+    tim1_overflows++;
 }
 
 
@@ -174,8 +653,9 @@ ISR(TIMER1_OVF_vect)
  * - **State 0:** Turns the dust sensor LED **ON** (active low) and sets a short TCNT2 delay 
  * (TCNT2=252) to allow the LED to stabilize.
  * - **State 1:** Takes the **ADC measurement** (`GP_read`) after the stabilization delay, 
- * turns the LED **OFF** (active high), and sets a longer TCNT2 delay (TCNT2=118) 
- * for the rest of the cycle before the next pulse.
+ * turns the LED **OFF** (active high), and sets a longer TCNT2 delay (TCNT2=dust_reload, 118 by default) 
+ * for the rest of the cycle before the next pulse. It also counts down the lockout of INT0
+ * after a CO2 alert edge.
  * * @param void
  * @return void
  */
@@ -184,8 +664,8 @@ ISR(TIMER2_OVF_vect)
 {
     static uint8_t state = 0;
     if(state == 0){
-        /* Turn LED on (active low) */
-        gpio_write_low(&PORTB, GP_LED_PIN);
+        /* Turn LED on (active low), single cbi */
+        GPIO_CLEAR(GP_LED_IO);
 
         /* Delay before sampling */
         TCNT2 = 252;      
@@ -195,11 +675,26 @@ ISR(TIMER2_OVF_vect)
         /* Sample dust sensor after LED-on interval */
         GP_read = adc_read(GP_ADC_CH);
 
+        /* Timestamp from timer 1, overflow may be pending during this ISR */
+        GP_time = tim1_timestamp();
+        if (flag_dust_sample) flag_dust_overrun = 1;
+        flag_dust_sample = 1;
+
+        /* End of alert lockout, a change while INT0 was off counts as an edge */
+        if (alert_lockout != 0 && --alert_lockout == 0) {
+            if (alert_sample()) {
+                alert_lockout = ALERT_LOCKOUT;
+            } else {
+                EIFR = (1<<INTF0);
+                EIMSK |= (1<<INT0);
+            }
+        }
+
         /* Turn LED off, adc_read() took some time */
-        gpio_write_high(&PORTB, GP_LED_PIN);
+        GPIO_SET(GP_LED_IO);
 
         /* Delay before next LED cycle */
-        TCNT2 = 118;      
+        TCNT2 = dust_reload;
         state = 0;
     }
 }
\ No newline at end of file
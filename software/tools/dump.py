@@ -0,0 +1,197 @@
+#!/usr/bin/env python3
+"""Download history or EEPROM log of src/main.c (lib/transfer) into CSV.
+
+Sends the dump command of the shell, receives the blocks as COBS frames
+with CRC-16 (see lib/telemetry) and acknowledges them. A bad or missing
+block is asked for again by nak, the device then resends every block from
+there on. Works with a serial port (needs pyserial) or a pty, e.g. of
+emu/dump_emu.
+
+Examples:
+    dump.py /dev/ttyUSB0 history history.csv
+    dump.py /dev/pts/5 log log.csv --raw log.bin
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+from modbus_master import Port
+from telemetry import cobs_decode, crc16
+
+TYPE_BLOCK = 0x02
+SOURCES = {"history": 0, "log": 1}
+ACK_EVERY = 4       # half of TRANSFER_WINDOW
+RETRIES = 10
+HISTORY = struct.Struct("<4h")
+LOG = struct.Struct("<H12hH")
+CHANNELS = ("temperature", "humidity", "co2", "dust")
+
+
+class Link:
+    """Shell commands out, frames and reply lines in."""
+
+    def __init__(self, port):
+        self.port = port
+        self.frame = bytearray()
+
+    def send(self, command):
+        self.port.write(command.encode("ascii") + b"\r")
+
+    def receive(self, timeout):
+        """Return record bytes, reply str, b"" for a bad frame, None at timeout."""
+        end = time.monotonic() + timeout
+        while time.monotonic() < end:
+            byte = self.port.read(1)
+            if not byte:
+                continue
+            if byte != b"\0":
+                self.frame += byte
+                continue
+            frame, self.frame = bytes(self.frame), bytearray()
+            if not frame:
+                continue
+            try:
+                data = cobs_decode(frame)
+            except ValueError:
+                data = b""
+            if len(data) >= 3 and crc16(data[:-2]) == data[-2] | data[-1] << 8:
+                return data[:-2]
+            if frame.endswith(b"\r\n"):
+                return frame.decode("ascii", "replace").rstrip()
+            return b""
+        return None
+
+
+def start(link, source, timeout):
+    """Send dump command, return item count, item size and block count."""
+    for _ in range(RETRIES):
+        link.send("dump " + source)
+        end = time.monotonic() + timeout
+        while time.monotonic() < end:
+            reply = link.receive(end - time.monotonic())
+            if isinstance(reply, str) and reply.startswith("dump "):
+                fields = reply.split()
+                if len(fields) == 5 and int(fields[1]) == SOURCES[source]:
+                    return int(fields[2]), int(fields[3]), int(fields[4])
+                sys.exit("unexpected reply: " + reply)
+    sys.exit("no reply to dump command")
+
+
+def download(link, source, blocks, timeout):
+    """Receive blocks in order, return their data and statistics."""
+    data = []
+    acked = 0
+    naked = None        # block of last nak, once per gap unless a frame is bad
+    naks = bad = 0
+    retries = 0
+    while len(data) < blocks:
+        record = link.receive(timeout)
+        if isinstance(record, str):
+            if record == "no dump":
+                sys.exit("device stopped the transfer, data changed")
+            continue
+        if record is None:
+            retries += 1
+            if retries > RETRIES:
+                sys.exit("no progress at block %d" % len(data))
+            naked = None
+        elif record == b"":
+            bad += 1
+            naked = None    # may be the resent block itself
+        elif len(record) < 4 or record[0] != TYPE_BLOCK or record[1] != SOURCES[source]:
+            continue
+        elif record[2] | record[3] << 8 == len(data):
+            data.append(record[4:])
+            retries = 0
+            if len(data) - acked >= ACK_EVERY or len(data) == blocks:
+                acked = len(data)
+                link.send("ack %d" % acked)
+            continue
+        elif record[2] | record[3] << 8 < len(data):
+            continue    # resent before our nak arrived
+        # gap, go-back-N: every block from the missing one on comes again
+        if naked != len(data):
+            naked = len(data)
+            link.send("nak %d" % naked)
+            naks += 1
+    return b"".join(data), naks, bad
+
+
+def history_csv(image, out):
+    out.write("index,temperature,humidity,co2,dust\n")
+    for index, values in enumerate(HISTORY.iter_unpack(image)):
+        out.write("%d,%d,%d,%d,%d\n" % ((index,) + values))
+
+
+def log_records(image):
+    """Valid records oldest first, the order of the ring as the device reads it."""
+    slots = [LOG.unpack_from(image, i * LOG.size) for i in range(len(image) // LOG.size)]
+    wrap = (0xFFFF // len(slots)) * len(slots)
+
+    def valid(slot):
+        raw = image[slot * LOG.size:(slot + 1) * LOG.size]
+        return slots[slot][0] != 0xFFFF and crc16(raw[:-2]) == slots[slot][-1]
+
+    newest = None
+    for slot in range(len(slots)):
+        following = (slot + 1) % len(slots)
+        if valid(slot) and not (valid(following) and
+                                slots[following][0] == (slots[slot][0] + 1) % wrap):
+            newest = slot
+            break
+    records = []
+    if newest is None:
+        return records
+    # the slot after the newest one may hold a torn record, it is never read
+    for age in range(len(slots) - 1):
+        slot = (newest - age) % len(slots)
+        if not valid(slot) or slots[slot][0] != (slots[newest][0] - age) % wrap:
+            break
+        records.append(slots[slot])
+    return records[::-1]
+
+
+def log_csv(image, out):
+    out.write("sequence," + ",".join("%s_%s" % (c, a) for c in CHANNELS
+                                    for a in ("min", "mean", "max")) + "\n")
+    for record in log_records(image):
+        sequence, values = record[0], record[1:13]
+        fields = [sequence]
+        for channel in range(len(CHANNELS)):
+            fields += [values[channel], values[4 + channel], values[8 + channel]]
+        out.write(",".join(str(v) for v in fields) + "\n")
+
+
+def main():
+    p = argparse.ArgumentParser(description="Download history or EEPROM log into CSV")
+    p.add_argument("port", help="serial port or pty")
+    p.add_argument("source", choices=sorted(SOURCES), help="data to download")
+    p.add_argument("output", help="CSV file, - for stdout")
+    p.add_argument("--baud", type=int, default=500000, help="baud rate of serial port")
+    p.add_argument("--timeout", type=float, default=0.2, help="seconds without a block before nak")
+    p.add_argument("--raw", metavar="FILE", help="save received bytes as they are, too")
+    args = p.parse_args()
+
+    link = Link(Port(args.port, args.baud, 0.02))
+    began = time.monotonic()
+    items, size, blocks = start(link, args.source, 1.0)
+    image, naks, bad = download(link, args.source, blocks, args.timeout)
+    seconds = time.monotonic() - began
+    if len(image) != items * size:
+        sys.exit("received %d bytes, expected %d" % (len(image), items * size))
+
+    if args.raw:
+        with open(args.raw, "wb") as raw:
+            raw.write(image)
+    out = sys.stdout if args.output == "-" else open(args.output, "w")
+    (history_csv if args.source == "history" else log_csv)(image, out)
+    if out is not sys.stdout:
+        out.close()
+    print("%d items of %d bytes in %d blocks, %.2f s, %d bad frames, %d naks"
+          % (items, size, blocks, seconds, bad, naks), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,240 @@
+#!/usr/bin/env python3
+"""Convert BDF or TTF fonts into PROGMEM fonts for lib/oled.
+
+Glyphs are stored as columns of display pages (bit 0 is the top row of
+a page), the same layout as the display buffer, so oled_font_puts() copies
+them without bit shuffling. Output is <name>.c and <name>.h with an
+oled_font_t named <name>.
+
+BDF is read directly. TTF/OTF needs freetype-py (pip install freetype-py)
+and --size.
+
+Examples:
+    fontconv.py fonts/digits24.bdf --name font_digits24 --rle -o lib/oled/fonts
+    fontconv.py DejaVuSans.ttf --size 12 --proportional --name font_sans12 -o out
+"""
+
+import argparse
+import os
+import sys
+
+
+class Glyph:
+    """Bitmap of one glyph, rows[y] is set of lit columns relative to origin."""
+
+    def __init__(self, advance, pixels):
+        self.advance = advance      # DWIDTH / horizontal advance
+        self.pixels = pixels        # set of (x, y), y = 0 at top of ascent
+
+
+def load_bdf(path):
+    """Return (glyphs by code, ascent, descent) of a BDF font."""
+    glyphs = {}
+    ascent = descent = None
+    bbox = None
+    with open(path, encoding="latin-1") as f:
+        lines = iter(f.read().splitlines())
+    for line in lines:
+        word = line.split()
+        if not word:
+            continue
+        if word[0] == "FONT_ASCENT":
+            ascent = int(word[1])
+        elif word[0] == "FONT_DESCENT":
+            descent = int(word[1])
+        elif word[0] == "FONTBOUNDINGBOX":
+            bbox = [int(v) for v in word[1:5]]
+        elif word[0] == "STARTCHAR":
+            code = advance = None
+            w = h = xoff = yoff = 0
+            for line in lines:
+                word = line.split()
+                if word[0] == "ENCODING":
+                    code = int(word[1])
+                elif word[0] == "DWIDTH":
+                    advance = int(word[1])
+                elif word[0] == "BBX":
+                    w, h, xoff, yoff = (int(v) for v in word[1:5])
+                elif word[0] == "BITMAP" or word[0] == "ENDCHAR":
+                    break
+            rows = []
+            if word[0] == "BITMAP":
+                for line in lines:
+                    if line.strip() == "ENDCHAR":
+                        break
+                    rows.append(int(line.strip() or "0", 16))
+            glyphs[code] = (advance, w, h, xoff, yoff, rows)
+    if ascent is None or descent is None:
+        if bbox is None:
+            sys.exit("%s: no FONT_ASCENT/FONT_DESCENT or FONTBOUNDINGBOX" % path)
+        ascent, descent = bbox[1] + bbox[3], -bbox[3]
+
+    result = {}
+    for code, (advance, w, h, xoff, yoff, rows) in glyphs.items():
+        if code is None or code < 0:
+            continue
+        bits = ((w + 7) // 8) * 8
+        top = ascent - (yoff + h)
+        pixels = set()
+        for y, row in enumerate(rows):
+            for x in range(w):
+                if row >> (bits - 1 - x) & 1:
+                    pixels.add((xoff + x, top + y))
+        result[code] = Glyph(advance if advance is not None else w, pixels)
+    return result, ascent, descent
+
+
+def load_ttf(path, size, codes):
+    """Return (glyphs by code, ascent, descent) of a TTF/OTF rendered at size px."""
+    try:
+        import freetype
+    except ImportError:
+        sys.exit("TTF conversion needs freetype-py: pip install freetype-py")
+    face = freetype.Face(path)
+    face.set_pixel_sizes(0, size)
+    ascent = face.size.ascender >> 6
+    descent = -face.size.descender >> 6
+    result = {}
+    for code in codes:
+        if face.get_char_index(code) == 0:
+            continue
+        face.load_char(chr(code), freetype.FT_LOAD_RENDER | freetype.FT_LOAD_TARGET_MONO)
+        slot = face.glyph
+        bitmap = slot.bitmap
+        pixels = set()
+        for y in range(bitmap.rows):
+            for x in range(bitmap.width):
+                if bitmap.buffer[y * bitmap.pitch + x // 8] & (0x80 >> (x % 8)):
+                    pixels.add((slot.bitmap_left + x, ascent - slot.bitmap_top + y))
+        result[code] = Glyph(slot.advance.x >> 6, pixels)
+    return result, ascent, descent
+
+
+def glyph_columns(glyph, pages, proportional, spacing):
+    """Return list of page-major bytes and the advance in columns."""
+    if proportional:
+        if glyph.pixels:
+            left = min(x for x, _ in glyph.pixels)
+            width = max(x for x, _ in glyph.pixels) - left + 1 + spacing
+        else:
+            left, width = 0, max(1, glyph.advance // 2)
+    else:
+        left, width = 0, glyph.advance
+    data = []
+    for page in range(pages):
+        for column in range(width):
+            byte = 0
+            for bit in range(8):
+                if (left + column, page * 8 + bit) in glyph.pixels:
+                    byte |= 1 << bit
+            data.append(byte)
+    return data, width
+
+
+def rle(data):
+    """Encode bytes: 0x80|n-1 repeats next byte n times, n-1 copies n literal bytes."""
+    out = []
+    i = 0
+    while i < len(data):
+        run = 1
+        while i + run < len(data) and data[i + run] == data[i] and run < 128:
+            run += 1
+        if run >= 3:
+            out += [0x80 | (run - 1), data[i]]
+            i += run
+            continue
+        start = i
+        while i < len(data) and i - start < 128:
+            if i + 2 < len(data) and data[i] == data[i + 1] == data[i + 2]:
+                break
+            i += 1
+        out += [i - start - 1] + data[start:i]
+    return out
+
+
+def c_array(values, per_line, fmt):
+    lines = []
+    for i in range(0, len(values), per_line):
+        lines.append("    " + ", ".join(fmt % v for v in values[i:i + per_line]) + ",")
+    return "\n".join(lines)
+
+
+def convert(args):
+    first, last = args.first, args.last
+    if args.source.lower().endswith((".ttf", ".otf")):
+        if not args.size:
+            sys.exit("--size is needed for TTF/OTF fonts")
+        glyphs, ascent, descent = load_ttf(args.source, args.size, range(first, last + 1))
+    else:
+        glyphs, ascent, descent = load_bdf(args.source)
+    codes = [c for c in glyphs if first <= c <= last]
+    if not codes:
+        sys.exit("%s: no glyphs in range 0x%02X-0x%02X" % (args.source, first, last))
+    first, last = min(codes), max(codes)
+    pages = (ascent + descent + 7) // 8
+
+    bitmap, offsets, widths = [], [], []
+    raw = 0
+    for code in range(first, last + 1):
+        offsets.append(len(bitmap))
+        if code not in glyphs:
+            widths.append(0)
+            continue
+        data, width = glyph_columns(glyphs[code], pages, args.proportional, args.spacing)
+        raw += len(data)
+        widths.append(width)
+        bitmap += rle(data) if args.rle else data
+    if len(bitmap) > 0xFFFF:
+        sys.exit("%s: bitmap too large (%d bytes)" % (args.source, len(bitmap)))
+
+    name = args.name
+    source = os.path.basename(args.source)
+    header = "/* Generated by tools/fontconv.py from %s, do not edit */\n" % source
+    os.makedirs(args.output, exist_ok=True)
+    with open(os.path.join(args.output, name + ".h"), "w") as f:
+        f.write(header)
+        f.write("#ifndef %s_H\n#define %s_H\n\n" % (name.upper(), name.upper()))
+        f.write("#include <oled.h>\n\n")
+        f.write("extern const oled_font_t %s PROGMEM;\n\n#endif\n" % name)
+    with open(os.path.join(args.output, name + ".c"), "w") as f:
+        f.write(header)
+        f.write("#include \"%s.h\"\n\n" % name)
+        f.write("// %d glyphs 0x%02X-0x%02X, %d px high, %d bytes bitmap (%d uncompressed)\n"
+                % (len(codes), first, last, pages * 8, len(bitmap), raw))
+        f.write("static const uint8_t %s_bitmap[] PROGMEM = {\n%s\n};\n"
+                % (name, c_array(bitmap, 16, "0x%02X")))
+        f.write("static const uint16_t %s_offset[] PROGMEM = {\n%s\n};\n"
+                % (name, c_array(offsets, 12, "%d")))
+        f.write("static const uint8_t %s_width[] PROGMEM = {\n%s\n};\n"
+                % (name, c_array(widths, 16, "%d")))
+        f.write("const oled_font_t %s PROGMEM = {\n" % name)
+        f.write("    0x%02X, 0x%02X, %d, %s,\n" % (first, last, pages, "OLED_FONT_RLE" if args.rle else "0"))
+        f.write("    %s_width, %s_offset, %s_bitmap\n};\n" % (name, name, name))
+    return len(bitmap), raw
+
+
+def parse(argv):
+    p = argparse.ArgumentParser(description="Convert BDF/TTF font to PROGMEM font of lib/oled")
+    p.add_argument("source", help="BDF, TTF or OTF font")
+    p.add_argument("--name", required=True, help="C name of font, also file name")
+    p.add_argument("-o", "--output", default=".", help="output directory")
+    p.add_argument("--size", type=int, help="pixel size of TTF/OTF font")
+    p.add_argument("--first", type=lambda v: int(v, 0), default=0x20, help="first character code")
+    p.add_argument("--last", type=lambda v: int(v, 0), default=0xFF, help="last character code")
+    p.add_argument("--proportional", action="store_true", help="trim glyphs to their ink width")
+    p.add_argument("--spacing", type=int, default=1, help="columns after proportional glyph")
+    p.add_argument("--rle", action="store_true", help="run-length compress glyph data")
+    args = p.parse_args(argv)
+    if not 0 <= args.first <= args.last <= 0xFF:
+        p.error("character codes have to be 0x00-0xFF")
+    return args
+
+
+def main(argv=None):
+    args = parse(argv)
+    size, raw = convert(args)
+    print("%s: %s, %d bytes (%d uncompressed)" % (args.name, args.source, size, raw))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,41 @@
+"""Generate PROGMEM fonts of lib/oled from the sources in fonts/.
+
+Runs as PlatformIO pre-build script (extra_scripts in platformio.ini) and
+from emu/Makefile as plain Python. A font is converted again when its
+source or the converter is newer than the generated file.
+"""
+
+import os
+import sys
+
+# source in fonts/, C name, converter options
+FONTS = [
+    ("font6x8.bdf", "font_prop8", ["--last", "0x7E", "--proportional"]),
+    ("digits16.bdf", "font_digits16", ["--rle"]),
+    ("digits24.bdf", "font_digits24", ["--rle"]),
+]
+
+try:
+    Import("env")  # noqa: F821 (PlatformIO/SCons)
+    ROOT = env.subst("$PROJECT_DIR")  # noqa: F821
+except NameError:
+    ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+sys.path.insert(0, os.path.join(ROOT, "tools"))
+import fontconv  # noqa: E402
+
+
+def generate():
+    output = os.path.join(ROOT, "lib", "oled", "fonts")
+    converter = os.path.join(ROOT, "tools", "fontconv.py")
+    for source, name, options in FONTS:
+        source = os.path.join(ROOT, "fonts", source)
+        targets = [os.path.join(output, name + ext) for ext in (".c", ".h")]
+        if all(os.path.exists(t) for t in targets):
+            built = min(os.path.getmtime(t) for t in targets)
+            if built >= os.path.getmtime(source) and built >= os.path.getmtime(converter):
+                continue
+        fontconv.main([source, "--name", name, "-o", output] + options)
+
+
+generate()
@@ -0,0 +1,164 @@
+#!/usr/bin/env python3
+"""Modbus RTU master for the slave of src/main.c (lib/modbus).
+
+Stands in for the building-management system: polls the input registers
+(live sample) and reads or writes holding registers (shell parameters).
+Works with a serial port (needs pyserial) or a pty, e.g. of emu/modbus_emu.
+
+Examples:
+    modbus_master.py /dev/ttyUSB0 --baud 500000 --slave 1
+    modbus_master.py /dev/pts/5 --poll 1
+    modbus_master.py /dev/pts/5 --holding 9 --write 3=4992
+"""
+
+import argparse
+import os
+import struct
+import sys
+import time
+
+TICK = 16e-6    # Timer1 tick in seconds
+INPUT_REGISTERS = 11
+EXCEPTIONS = {1: "illegal function", 2: "illegal data address", 3: "illegal data value"}
+
+
+def crc16(data):
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0xA001 if crc & 1 else crc >> 1
+    return crc
+
+
+class Port:
+    """Serial port by pyserial, or raw pty/tty by termios."""
+
+    def __init__(self, path, baud, timeout):
+        self.timeout = timeout
+        try:
+            import serial
+            self.serial = serial.Serial(path, baud, timeout=timeout)
+            self.fd = None
+        except ImportError:
+            import termios
+            import tty
+            self.serial = None
+            self.fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+            tty.setraw(self.fd)
+            attr = termios.tcgetattr(self.fd)
+            speed = getattr(termios, "B%d" % baud, None)
+            if speed is not None:
+                attr[4] = attr[5] = speed
+            termios.tcsetattr(self.fd, termios.TCSANOW, attr)
+
+    def write(self, data):
+        if self.serial:
+            self.serial.write(data)
+        else:
+            os.write(self.fd, data)
+
+    def read(self, size):
+        """Read up to size bytes, stop at timeout."""
+        if self.serial:
+            return self.serial.read(size)
+        import select
+        data = b""
+        end = time.monotonic() + self.timeout
+        while len(data) < size:
+            left = end - time.monotonic()
+            if left <= 0 or not select.select([self.fd], [], [], left)[0]:
+                break
+            data += os.read(self.fd, size - len(data))
+        return data
+
+    def flush_input(self):
+        if self.serial:
+            self.serial.reset_input_buffer()
+        else:
+            import termios
+            termios.tcflush(self.fd, termios.TCIFLUSH)
+
+
+class ModbusError(Exception):
+    pass
+
+
+class Master:
+    def __init__(self, port, slave):
+        self.port = port
+        self.slave = slave
+
+    def request(self, function, payload, reply_size):
+        frame = bytes([self.slave, function]) + payload
+        frame += struct.pack("<H", crc16(frame))
+        self.port.flush_input()
+        self.port.write(frame)
+        reply = self.port.read(5)
+        if len(reply) == 5 and reply[1] == function | 0x80:
+            if crc16(reply[:3]) != reply[3] | reply[4] << 8:
+                raise ModbusError("bad CRC of exception")
+            raise ModbusError("exception %d, %s" % (reply[2], EXCEPTIONS.get(reply[2], "?")))
+        reply += self.port.read(reply_size - len(reply))
+        if len(reply) < reply_size:
+            raise ModbusError("timeout, %d of %d bytes" % (len(reply), reply_size))
+        if crc16(reply[:-2]) != reply[-2] | reply[-1] << 8:
+            raise ModbusError("bad CRC")
+        if reply[0] != self.slave or reply[1] != function:
+            raise ModbusError("unexpected reply %s" % reply.hex())
+        return reply[2:-2]
+
+    def read_registers(self, function, start, count):
+        data = self.request(function, struct.pack(">HH", start, count), 5 + 2 * count)
+        return list(struct.unpack(">%dH" % count, data[1:]))
+
+    def write_register(self, index, value):
+        self.request(0x06, struct.pack(">HH", index, value), 8)
+
+
+def sample(registers):
+    """Decode input registers, see telemetry_sample_t."""
+    r = registers
+    temperature = r[6] - 0x10000 if r[6] & 0x8000 else r[6]
+    return ("t=%.5f s adc_co2=%d adc_dust=%d dht12=%s temperature=%.1f C "
+            "humidity=%.1f %% co2=%d ppm dust=%.1f ug/m3 flags=0x%02x"
+            % ((r[0] | r[1] << 16) * TICK, r[2], r[3], struct.pack("<HH", r[4], r[5]).hex(),
+               temperature / 10, r[7] / 10, r[8], r[9] / 10, r[10] & 0xFF))
+
+
+def main():
+    p = argparse.ArgumentParser(description="Modbus RTU master for the air quality monitor")
+    p.add_argument("port", help="serial port or pty")
+    p.add_argument("--baud", type=int, default=500000, help="baud rate of serial port")
+    p.add_argument("--slave", type=int, default=1, help="slave address")
+    p.add_argument("--timeout", type=float, default=0.2, help="reply timeout in seconds")
+    p.add_argument("--holding", type=int, metavar="COUNT", help="read COUNT holding registers")
+    p.add_argument("--write", action="append", default=[], metavar="REG=VALUE",
+                   help="write holding register, may be repeated")
+    p.add_argument("--poll", type=float, metavar="SECONDS", help="read input registers periodically")
+    args = p.parse_args()
+
+    master = Master(Port(args.port, args.baud, args.timeout), args.slave)
+    try:
+        for item in args.write:
+            index, value = (int(v, 0) for v in item.split("="))
+            master.write_register(index, value)
+            print("holding %d = %d" % (index, value))
+        if args.holding:
+            for index, value in enumerate(master.read_registers(0x03, 0, args.holding)):
+                print("holding %d = %d" % (index, value))
+        if args.write or args.holding:
+            return
+        while True:
+            print(sample(master.read_registers(0x04, 0, INPUT_REGISTERS)))
+            if not args.poll:
+                break
+            time.sleep(args.poll)
+    except ModbusError as error:
+        sys.exit("slave %d: %s" % (args.slave, error))
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
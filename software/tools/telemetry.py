@@ -0,0 +1,149 @@
+#!/usr/bin/env python3
+"""Decode binary telemetry of src/main.c (lib/telemetry) into CSV.
+
+Reads COBS frames delimited by 0x00 from a serial port (needs pyserial)
+or from a capture file ('-' for stdin), checks CRC-16/MODBUS and prints
+one CSV line per sample record. Window statistics (lib/stats) are printed
+on stderr, bad frames and lost sequence numbers are counted there. Blocks
+of a bulk transfer are left to dump.py. Reply lines of the command shell are printed on stderr, --send
+writes shell commands to the serial port.
+
+Examples:
+    telemetry.py /dev/ttyUSB0 --baud 500000 > samples.csv
+    telemetry.py /dev/ttyUSB0 --send "set dust_us 4992" --send stats > samples.csv
+    telemetry.py capture.bin
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+SAMPLE = struct.Struct("<BBIHH4shHHHB")
+TYPE_SAMPLE = 0x01
+TYPE_BLOCK = 0x02
+TYPE_STATS = 0x03
+STATS = struct.Struct("<BBB" + "hHhh" * 4)
+LEVELS = ("1min", "15min", "1h")
+CHANNELS = (("temperature_c", 10), ("humidity_pct", 10), ("co2_ppm", 1), ("dust_ugm3", 10))
+TICK = 16e-6    # Timer1 tick in seconds
+FIELDS = ("time_s", "seq", "adc_co2", "adc_dust", "dht12", "temperature_c",
+          "humidity_pct", "co2_ppm", "dust_ugm3", "alert", "overrun", "values")
+
+
+def cobs_decode(frame):
+    out = bytearray()
+    i = 0
+    while i < len(frame):
+        code = frame[i]
+        if code == 0 or i + code > len(frame):
+            raise ValueError("bad COBS code")
+        out += frame[i + 1:i + code]
+        i += code
+        if code != 0xFF and i < len(frame):
+            out.append(0)
+    return bytes(out)
+
+
+def crc16(data):
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0xA001 if crc & 1 else crc >> 1
+    return crc
+
+
+def records(stream):
+    """Yield decoded records, None for each bad frame, str for shell replies."""
+    frame = bytearray()
+    while True:
+        chunk = stream.read(256)
+        if not chunk:
+            return
+        for byte in chunk:
+            if byte != 0:
+                frame.append(byte)
+                continue
+            if frame:
+                try:
+                    data = cobs_decode(frame)
+                except ValueError:
+                    data = b""
+                if len(data) >= 3 and crc16(data[:-2]) == data[-2] | data[-1] << 8:
+                    yield data[:-2]
+                elif frame.endswith(b"\r\n"):
+                    yield frame.decode("ascii", "replace").rstrip()
+                else:
+                    yield None
+            frame = bytearray()
+
+
+def open_input(args):
+    if args.source == "-":
+        return sys.stdin.buffer
+    if args.source.startswith(("/dev/", "COM")):
+        try:
+            import serial
+        except ImportError:
+            sys.exit("serial ports need pyserial: pip install pyserial")
+        return serial.Serial(args.source, args.baud, timeout=1)
+    return open(args.source, "rb")
+
+
+def print_stats(fields):
+    """One stderr line: level, items, mean, std and range of every channel."""
+    level, items, values = fields[1], fields[2], fields[3:]
+    text = ["stats %s (%d)" % (LEVELS[level] if level < len(LEVELS) else level, items)]
+    for i, (name, scale) in enumerate(CHANNELS):
+        mean, std, low, high = (v / scale for v in values[4 * i:4 * i + 4])
+        text.append("%s %g sd %g [%g, %g]" % (name, mean, std, low, high))
+    print(", ".join(text), file=sys.stderr)
+
+
+def main():
+    p = argparse.ArgumentParser(description="Decode binary telemetry to CSV")
+    p.add_argument("source", help="serial port, capture file or - for stdin")
+    p.add_argument("--baud", type=int, default=500000, help="baud rate of serial port")
+    p.add_argument("--send", action="append", default=[], metavar="COMMAND",
+                   help="shell command to send first, may be repeated")
+    args = p.parse_args()
+
+    stream = open_input(args)
+    for command in args.send:
+        if not hasattr(stream, "write"):
+            sys.exit("--send needs a serial port")
+        stream.write(command.encode("ascii") + b"\n")
+        time.sleep(0.1)     # shell reads one line at a time, receive ring is short
+
+    bad = lost = 0
+    last = None
+    print(",".join(FIELDS))
+    try:
+        for record in records(stream):
+            if isinstance(record, str):
+                print(record, file=sys.stderr)
+                continue
+            if record is not None and record[0] == TYPE_BLOCK:
+                continue
+            if record is not None and record[0] == TYPE_STATS and len(record) == STATS.size:
+                print_stats(STATS.unpack(record))
+                continue
+            if record is None or record[0] != TYPE_SAMPLE or len(record) != SAMPLE.size:
+                bad += 1
+                continue
+            (_, seq, stamp, adc_co2, adc_dust, dht12,
+             temp, hum, co2, dust, flags) = SAMPLE.unpack(record)
+            if last is not None:
+                lost += (seq - last - 1) & 0xFF
+            last = seq
+            print("%.5f,%d,%d,%d,%s,%.1f,%.1f,%d,%.1f,%d,%d,%d" % (
+                stamp * TICK, seq, adc_co2, adc_dust, dht12.hex(), temp / 10, hum / 10,
+                co2, dust / 10, flags & 1, flags >> 1 & 1, flags >> 2 & 1))
+    except KeyboardInterrupt:
+        pass
+    print("bad frames %d, lost records %d" % (bad, lost), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()